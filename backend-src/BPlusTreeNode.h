@@ -1,8 +1,13 @@
+#ifndef BPLUSTREENODE_H
+#define BPLUSTREENODE_H
+
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <string>
 
+#include "FileRegistry.h"
+
 // Define the order of the B+ Tree (max keys per node)
 const int ORDER = 4;
 
@@ -11,12 +16,12 @@ class BPlusTreeNode;
 
 struct FileIndexData {
     // Unique ID for the file
-    std::string file_id; 
+    FileID file_id; 
     // Pointer to the start block on the simulated disk
     long long disk_block_address; 
 
     // Constructor for convenience
-    FileIndexData(const std::string& id, long long addr) 
+    FileIndexData(FileID id, long long addr) 
         : file_id(id), disk_block_address(addr) {}
 };
 
@@ -53,4 +58,6 @@ public:
     int findKeyIndex(const std::string& key) {
         return std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
     }
-};
\ No newline at end of file
+};
+
+#endif
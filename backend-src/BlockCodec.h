@@ -0,0 +1,175 @@
+#ifndef BLOCKCODEC_H
+#define BLOCKCODEC_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Small LZ77 codec for cache blocks (LZ4-style byte format, no dependencies).
+// A stream is a series of sequences:
+//   token  : high nibble = literal count, low nibble = match length - 4
+//            (15 in either nibble means "more length bytes follow", 255 = keep going)
+//   literals
+//   offset : 2 bytes little-endian, distance back into the output
+// The final sequence carries literals only and ends the stream.
+namespace BlockCodec {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+
+inline uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Position of the lowest set bit (v != 0)
+inline int lowestBit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return (int)index;
+#else
+    int bit = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Length of the common run of a and b, at most 'limit' bytes (8 bytes per step)
+inline size_t commonLength(const char* a, const char* b, size_t limit) {
+    size_t n = 0;
+    while (n + 8 <= limit) {
+        uint64_t diff = read64(a + n) ^ read64(b + n);
+        if (diff) return n + (lowestBit(diff) >> 3); // Little-endian: lowest differing byte
+        n += 8;
+    }
+    while (n < limit && a[n] == b[n]) n++;
+    return n;
+}
+
+inline void writeLength(std::vector<char>& out, size_t extra) {
+    while (extra >= 255) {
+        out.push_back((char)255);
+        extra -= 255;
+    }
+    out.push_back((char)extra);
+}
+
+inline void emitSequence(std::vector<char>& out, const char* literals, size_t literal_len,
+                         size_t offset, size_t match_len) {
+    size_t match_code = match_len ? match_len - MIN_MATCH : 0;
+    uint8_t token = (uint8_t)((literal_len < 15 ? literal_len : 15) << 4) | (uint8_t)(match_code < 15 ? match_code : 15);
+    out.push_back((char)token);
+    if (literal_len >= 15) writeLength(out, literal_len - 15);
+    out.insert(out.end(), literals, literals + literal_len);
+
+    if (match_len == 0) return; // Last sequence
+    out.push_back((char)(offset & 0xFF));
+    out.push_back((char)(offset >> 8));
+    if (match_code >= 15) writeLength(out, match_code - 15);
+}
+
+// Compress src[0..len) into out (replacing its contents)
+inline void compress(const char* src, size_t len, std::vector<char>& out) {
+    out.clear();
+    out.reserve(len / 2 + 16);
+
+    int32_t table[1 << HASH_BITS];
+    std::fill(table, table + (1 << HASH_BITS), -1);
+
+    size_t anchor = 0;
+    size_t i = 0;
+    size_t misses = 0; // Stride grows on incompressible stretches, so they are skipped quickly
+    while (i + MIN_MATCH <= len) {
+        uint32_t seq = read32(src + i);
+        uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+        int32_t candidate = table[h];
+        table[h] = (int32_t)i;
+
+        if (candidate >= 0 && i - candidate <= MAX_OFFSET && read32(src + candidate) == seq) {
+            size_t match_len = MIN_MATCH + commonLength(src + candidate + MIN_MATCH, src + i + MIN_MATCH, len - i - MIN_MATCH);
+
+            emitSequence(out, src + anchor, i - anchor, i - candidate, match_len);
+            i += match_len;
+            anchor = i;
+            misses = 0;
+        } else {
+            i += 1 + (misses++ >> 5);
+        }
+    }
+    emitSequence(out, src + anchor, len - anchor, 0, 0);
+}
+
+// Decompress into dst (capacity dst_cap). Returns the decoded size, or -1 if the input is corrupt.
+inline long long decompress(const char* src, size_t len, char* dst, size_t dst_cap) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end = ip + len;
+    size_t op = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t literal_len = token >> 4;
+        if (literal_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) return -1;
+                b = *ip++;
+                literal_len += b;
+            } while (b == 255);
+        }
+        if ((size_t)(end - ip) < literal_len || dst_cap - op < literal_len) return -1;
+        std::memcpy(dst + op, ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+
+        if (ip == end) break; // Last sequence has no match
+
+        if (end - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t match_len = (token & 0x0F);
+        if (match_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) return -1;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += MIN_MATCH;
+
+        if (offset == 0 || offset > op || dst_cap - op < match_len) return -1;
+        // A match may overlap the bytes it produces, so copy 8 bytes at a time only
+        // when the source is at least 8 behind (and there is room to overshoot)
+        if (offset >= 8 && dst_cap - op >= match_len + 8) {
+            for (size_t k = 0; k < match_len; k += 8) std::memcpy(dst + op + k, dst + op + k - offset, 8);
+        } else {
+            for (size_t k = 0; k < match_len; ++k) dst[op + k] = dst[op + k - offset];
+        }
+        op += match_len;
+    }
+    return (long long)op;
+}
+
+} // namespace BlockCodec
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef CACHEMANAGER_H
+#define CACHEMANAGER_H
+
 #include <list>
 #include <vector>
 #include <unordered_map>
@@ -5,11 +8,15 @@
 #include <iostream>
 #include <algorithm>
 
+#include "Metrics.h"
+#include "BlockCodec.h"
+
 // Structure to hold data blocks in the cache
 struct CacheBlock {
     std::string block_id; // Key (e.g., file_id + block_number)
     std::vector<char> data; // The actual file data content
     long long access_count = 0; // The priority metric
+    bool prefetched = false; // Loaded on a prediction and not yet read by anyone
 
     CacheBlock(const std::string& id, size_t size) : block_id(id), data(size) {}
 };
@@ -19,23 +26,122 @@ using BlockList = std::list<CacheBlock>;
 // Typedef for the mapping: Key -> Iterator to the list element
 using BlockMap = std::unordered_map<std::string, BlockList::iterator>;
 
+// A block demoted to the compressed tier
+struct CompressedBlock {
+    std::string block_id;
+    std::vector<char> data; // BlockCodec stream
+    uint32_t raw_size;
+    bool prefetched;
+};
+
+using CompressedList = std::list<CompressedBlock>;
+using CompressedMap = std::unordered_map<std::string, CompressedList::iterator>;
+
 class CacheManager {
 private:
     BlockList lru_list; // Doubly Linked List for LRU eviction (Min-Heap logic)
     BlockMap block_map; // Hash Table for O(1) lookup
     const size_t MAX_SIZE;
 
+    // Second tier: blocks evicted from the list above are kept compressed here,
+    // bounded by compressed bytes rather than by count. A hit decompresses the
+    // block and promotes it back. Disabled when the budget is 0.
+    CompressedList compressed_list;
+    CompressedMap compressed_map;
+    size_t compressed_bytes = 0;
+    const size_t COMPRESSED_BUDGET;
+
+    // Only keep blocks that shrink to 3/4 or less; otherwise decompressing isn't worth it
+    void demote(CacheBlock& block) {
+        if (COMPRESSED_BUDGET > 0) {
+            std::vector<char> packed;
+            BlockCodec::compress(block.data.data(), block.data.size(), packed);
+            if (packed.size() * 4 <= block.data.size() * 3 && packed.size() <= COMPRESSED_BUDGET) {
+                packed.shrink_to_fit(); // The point of this tier is the memory saved
+                compressed_bytes += packed.size();
+                compressed_list.push_front(CompressedBlock{block.block_id, std::move(packed), (uint32_t)block.data.size(), block.prefetched});
+                compressed_map[block.block_id] = compressed_list.begin();
+                CMFS_COUNT(CACHE_DEMOTIONS, 1);
+
+                while (compressed_bytes > COMPRESSED_BUDGET) {
+                    eraseCompressed(compressed_map.find(compressed_list.back().block_id), true);
+                }
+                return;
+            }
+        }
+        if (block.prefetched) {
+            CMFS_COUNT(PREFETCH_WASTED, 1);
+        }
+        CMFS_COUNT(CACHE_EVICTIONS, 1);
+    }
+
+    // evicted = the block leaves the cache for good (as opposed to being promoted/replaced)
+    void eraseCompressed(CompressedMap::iterator it_map, bool evicted) {
+        if (evicted) {
+            if (it_map->second->prefetched) {
+                CMFS_COUNT(PREFETCH_WASTED, 1);
+            }
+            CMFS_COUNT(CACHE_EVICTIONS, 1);
+        }
+        compressed_bytes -= it_map->second->data.size();
+        compressed_list.erase(it_map->second);
+        compressed_map.erase(it_map);
+    }
+
+    // Move a block from the compressed tier back into the LRU list
+    bool promote(const std::string& block_id) {
+        auto it_map = compressed_map.find(block_id);
+        if (it_map == compressed_map.end()) return false;
+
+        const CompressedBlock& packed = *it_map->second;
+        CacheBlock block(block_id, packed.raw_size);
+        long long len = BlockCodec::decompress(packed.data.data(), packed.data.size(), block.data.data(), block.data.size());
+        block.prefetched = packed.prefetched;
+        eraseCompressed(it_map, false);
+        if (len != (long long)block.data.size()) return false; // Corrupt stream, treat as a miss
+
+        insertFront(std::move(block));
+        return true;
+    }
+
+    void insertFront(CacheBlock&& block) {
+        // Check for eviction (Min-Heap/LRU logic)
+        if (lru_list.size() >= MAX_SIZE) {
+            // Evict the Least Recently Used item (at the back of the list)
+
+            // In a *pure* Min-Heap, we'd evict the item with the lowest access_count.
+            // In this LRU-based system, we evict the least recently used,
+            // simulating the Min-Heap's role as the eviction candidate tracker.
+            CacheBlock& victim = lru_list.back();
+            block_map.erase(victim.block_id); // Remove from map
+            demote(victim);
+            lru_list.pop_back(); // Remove from list
+        }
+
+        lru_list.push_front(std::move(block));
+
+        // Update the map to point to the new head of the list
+        block_map[lru_list.front().block_id] = lru_list.begin();
+    }
+
 public:
-    CacheManager(size_t max_size) : MAX_SIZE(max_size) {}
+    CacheManager(size_t max_size, size_t compressed_budget = 0)
+        : MAX_SIZE(max_size), COMPRESSED_BUDGET(compressed_budget) {}
 
     // 1. Get a block from the cache
     bool getBlock(const std::string& block_id, CacheBlock& block_out) {
         auto it_map = block_map.find(block_id);
         
         if (it_map == block_map.end()) {
-            // Cache Miss
-            return false;
+            if (!promote(block_id)) {
+                // Cache Miss
+                CMFS_COUNT(CACHE_MISSES, 1);
+                return false;
+            }
+            CMFS_COUNT(CACHE_COMPRESSED_HITS, 1);
+            it_map = block_map.find(block_id);
         }
+        CMFS_COUNT(CACHE_HITS, 1);
 
         // Cache Hit: Increment Priority and Promote to Front (LRU policy)
         
@@ -44,6 +150,11 @@ public:
         
         // 2. Increment the priority count
         it_list->access_count++; 
+        if (it_list->prefetched) {
+            // The prediction paid off
+            it_list->prefetched = false;
+            CMFS_COUNT(PREFETCH_USED, 1);
+        }
         
         // 3. Promote the block to the front of the list (Most Recently Used)
         // This is the LRU part: The front of the list is high priority/most recently used.
@@ -54,35 +165,85 @@ public:
     }
 
     // 2. Put a block into the cache
-    void putBlock(const std::string& block_id, const std::vector<char>& data) {
+    // prefetch = true marks blocks loaded on a prediction rather than a demand read
+    void putBlock(const std::string& block_id, const std::vector<char>& data, bool prefetch = false) {
         // If block already exists (we hit the 'get' first, but for completeness):
         if (block_map.count(block_id)) {
             // Already handled by getBlock and update
             return; 
         }
 
-        // Check for eviction (Min-Heap/LRU logic)
-        if (lru_list.size() >= MAX_SIZE) {
-            // Evict the Least Recently Used item (at the back of the list)
-            
-            // In a *pure* Min-Heap, we'd evict the item with the lowest access_count.
-            // In this LRU-based system, we evict the least recently used, 
-            // simulating the Min-Heap's role as the eviction candidate tracker.
-            
-            std::string evicted_id = lru_list.back().block_id;
-            lru_list.pop_back(); // Remove from list
-            block_map.erase(evicted_id); // Remove from map
-            std::cout << "[CMFS Cache] Evicting block: " << evicted_id << std::endl;
+        // A stale compressed copy is replaced by the fresh one
+        auto it_packed = compressed_map.find(block_id);
+        if (it_packed != compressed_map.end()) {
+            eraseCompressed(it_packed, false);
         }
 
         // Insert new block at the front (Most Recently Used)
-        CacheBlock new_block(block_id, data.size());
+        CacheBlock new_block(block_id, 0);
         new_block.data = data;
-        new_block.access_count = 1; // Initial access
-        
-        lru_list.push_front(new_block);
-        
-        // Update the map to point to the new head of the list
-        block_map[block_id] = lru_list.begin();
+        new_block.access_count = prefetch ? 0 : 1; // Initial access
+        new_block.prefetched = prefetch;
+        if (prefetch) {
+            CMFS_COUNT(PREFETCH_ISSUED, 1);
+        }
+
+        insertFront(std::move(new_block));
     }
-};
\ No newline at end of file
+
+    // 3. Drop a block whose backing data changed (write/delete)
+    void invalidate(const std::string& block_id) {
+        auto it_packed = compressed_map.find(block_id);
+        if (it_packed != compressed_map.end()) {
+            if (it_packed->second->prefetched) {
+                CMFS_COUNT(PREFETCH_WASTED, 1);
+            }
+            eraseCompressed(it_packed, false);
+        }
+
+        auto it_map = block_map.find(block_id);
+        if (it_map == block_map.end()) return;
+
+        if (it_map->second->prefetched) {
+            CMFS_COUNT(PREFETCH_WASTED, 1);
+        }
+        lru_list.erase(it_map->second);
+        block_map.erase(it_map);
+    }
+
+    bool contains(const std::string& block_id) const {
+        return block_map.count(block_id) > 0 || compressed_map.count(block_id) > 0;
+    }
+
+    // True only if the block sits in the compressed tier (a hit there pays for decompression)
+    bool isCompressed(const std::string& block_id) const {
+        return compressed_map.count(block_id) > 0;
+    }
+
+    size_t size() const { return lru_list.size(); }
+    size_t capacity() const { return MAX_SIZE; }
+    size_t compressedSize() const { return compressed_list.size(); }
+    size_t compressedBytes() const { return compressed_bytes; }
+    size_t compressedBudget() const { return COMPRESSED_BUDGET; }
+
+    // Approximate heap footprint: block payloads plus list/map node overhead
+    size_t memoryUsage() const {
+        size_t bytes = block_map.bucket_count() * sizeof(void*);
+        for (const CacheBlock& block : lru_list) {
+            bytes += sizeof(CacheBlock) + 2 * sizeof(void*);          // list node
+            bytes += block.data.capacity();
+            bytes += sizeof(BlockMap::value_type) + 2 * sizeof(void*); // map node
+            if (block.block_id.capacity() > 15) bytes += 2 * (block.block_id.capacity() + 1);
+        }
+        bytes += compressed_map.bucket_count() * sizeof(void*);
+        for (const CompressedBlock& block : compressed_list) {
+            bytes += sizeof(CompressedBlock) + 2 * sizeof(void*);
+            bytes += block.data.capacity();
+            bytes += sizeof(CompressedMap::value_type) + 2 * sizeof(void*);
+            if (block.block_id.capacity() > 15) bytes += 2 * (block.block_id.capacity() + 1);
+        }
+        return bytes;
+    }
+};
+
+#endif
\ No newline at end of file
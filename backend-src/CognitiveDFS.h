@@ -0,0 +1,922 @@
+#ifndef COGNITIVEDFS_H
+#define COGNITIVEDFS_H
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#include "Protocol.h"
+#include "FileRegistry.h"
+#include "DependencyGraph.h"
+#include "FilenameTrie.h"
+#include "BPlusTreeNode.h" 
+#include "MetadataCache.h"
+#include "CacheManager.h"
+#include "VirtualDisk.h"
+#include "ContentStore.h"
+#include "Metrics.h"
+#include "NamespaceWatcher.h"
+
+namespace fs = std::filesystem;
+
+// Optional storage/cache features, all off by default
+struct EngineOptions {
+    size_t compressed_cache_bytes = 0; // Budget of the compressed cache tier (0 = no tier)
+    bool dedup = false;                // Keep contents in a deduplicating block image instead of one host file each
+    long long dedup_blocks = 65536;    // Size of that image in 4 KB blocks (256 MB, sparse)
+};
+
+// --- The Core File System Controller ---
+class CognitiveDFS {
+private:
+    std::string storage_path;
+    std::ostream& out; // Where JSON responses go (stdout for the Node bridge)
+    FileRegistry registry;
+    DependencyGraph* graph;
+    FilenameTrie* trie; // Only needed for prefix lookups, so built on first use
+    bool trie_built = false;
+    MetadataCache* metadata;
+    CacheManager* cache;
+    ContentStore* store = nullptr; // Dedup mode only
+    bool ready = true;             // False if existing state couldn't be loaded; nothing is saved then
+    NamespaceWatcher watcher;
+    
+    //reverse index keywords to files
+    std::map<std::string, std::vector<FileID>> keyword_index;
+    //forward index files to keywords
+    std::unordered_map<FileID, std::vector<std::string>> file_keywords;
+    //system keywords
+    std::vector<std::string> system_keywords = {"important", "draft", "source", "config", "data"};
+
+    const int K_MAX_KEYS = 5;
+
+    // What the last READ predicted, loaded by runPrefetch() once the response is out
+    std::vector<Dependency> pending_prefetch;
+
+public:
+    static const size_t DEFAULT_CACHE_BLOCKS = 1024; // 4 MB of 4 KB blocks
+
+    CognitiveDFS(size_t cache_blocks = DEFAULT_CACHE_BLOCKS,
+                 const std::string& path = "C:/cmfs_storage/",
+                 std::ostream& output = std::cout,
+                 const EngineOptions& options = EngineOptions())
+        : out(output) {
+        storage_path = path;
+        if (!storage_path.empty() && storage_path.back() != '/') storage_path += '/';
+        if (!fs::exists(storage_path)) {
+            fs::create_directories(storage_path);
+        }
+        
+        graph = new DependencyGraph();
+        trie = new FilenameTrie();
+        metadata = new MetadataCache();
+        cache = new CacheManager(cache_blocks, options.compressed_cache_bytes);
+
+        // Dedup mode: the namespace is whatever the store's index says; the
+        // directory isn't used, so there is nothing to watch or scan.
+        if (options.dedup) {
+            store = new ContentStore(imagePath(), options.dedup_blocks);
+            if (!store->load(registry)) {
+                ready = false;
+                return;
+            }
+            std::cerr << "[CMFS] System Initialized. Content store: " << imagePath()
+                      << " (" << registry.size() << " files)\n";
+            return;
+        }
+        
+        // Start watching before loading so nothing slips in between
+        watcher.start(storage_path);
+        bool from_manifest = loadManifest();
+        if (!from_manifest) {
+            for (const auto& entry : fs::directory_iterator(storage_path)) {
+                if (entry.is_regular_file()) {
+                    registry.intern(entry.path().filename().string());
+                }
+            }
+        }
+        
+        std::cerr << "[CMFS] System Initialized. Storage: " << storage_path
+                  << " (" << registry.size() << " files from " << (from_manifest ? "manifest" : "directory scan") << ")\n";
+    }
+
+    ~CognitiveDFS() {
+        if (!ready) {
+            // Leave whatever is on disk alone
+        } else if (store) {
+            store->save(registry);
+        } else {
+            saveManifest();
+        }
+        delete graph; delete trie; delete metadata; delete cache; delete store;
+    }
+
+    // False if the engine must not serve requests (see main.cpp)
+    bool isReady() const { return ready; }
+
+    // --- Namespace manifest ---
+    // The list of filenames is saved next to the storage directory on shutdown,
+    // stamped with the directory's mtime. On startup it is trusted only if the
+    // directory hasn't changed since; otherwise we fall back to a full scan.
+    std::string manifestPath() const {
+        return storage_path.substr(0, storage_path.size() - 1) + ".manifest";
+    }
+
+    // Dedup mode keeps every file in one block image next to the storage directory
+    std::string imagePath() const {
+        return storage_path.substr(0, storage_path.size() - 1) + ".img";
+    }
+
+private:
+    // Called once, on shutdown (it stops the watcher)
+    bool saveManifest() {
+        std::error_code ec;
+        auto stamp = fs::last_write_time(storage_path, ec);
+        if (ec) return false;
+
+        // Take the stamp first: any change before it is now either queued or on disk
+        if (watcher.isActive()) {
+            watcher.shutdown();
+            syncNamespace();
+        } else {
+            rescan();
+        }
+
+        std::string tmp_path = manifestPath() + ".tmp";
+        std::ofstream outfile(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!outfile.is_open()) return false;
+
+        outfile << "CMFS-MANIFEST 1 " << (long long)stamp.time_since_epoch().count() << " " << registry.size() << "\n";
+        registry.forEach([&](FileID, std::string_view name) {
+            outfile << name << '\n';
+        });
+        outfile.close();
+        if (!outfile) return false;
+
+        fs::rename(tmp_path, manifestPath(), ec);
+        return !ec;
+    }
+
+    bool loadManifest() {
+        std::error_code ec;
+        auto stamp = fs::last_write_time(storage_path, ec);
+        if (ec) return false;
+
+        // One read for the whole file, then split in memory
+        std::ifstream infile(manifestPath(), std::ios::binary | std::ios::ate);
+        if (!infile.is_open()) return false;
+        std::string data(infile.tellg(), '\0');
+        infile.seekg(0);
+        infile.read(&data[0], data.size());
+        if (!infile) return false;
+
+        long long saved_stamp = 0;
+        size_t count = 0;
+        if (std::sscanf(data.substr(0, data.find('\n')).c_str(), "CMFS-MANIFEST 1 %lld %zu", &saved_stamp, &count) != 2) return false;
+        if (saved_stamp != (long long)stamp.time_since_epoch().count()) return false; // Changed while we were down
+
+        size_t header_end = data.find('\n');
+        if (header_end == std::string::npos) return true;
+        registry.loadNames(std::move(data), header_end + 1);
+        return true;
+    }
+
+    FilenameTrie& prefixIndex() {
+        if (!trie_built) {
+            registry.forEach([&](FileID id, std::string_view name) {
+                trie->insert(std::string(name), id);
+            });
+            trie_built = true;
+        }
+        return *trie;
+    }
+
+    struct DiskState {
+        bool present = false;
+        long long size = 0;
+        long long stamp = 0; // last_write_time
+    };
+
+    DiskState diskState(const std::string& filename) const {
+        DiskState state;
+        std::error_code ec;
+        std::string path = storage_path + filename;
+        state.present = fs::is_regular_file(path, ec);
+        if (!state.present) return state;
+        state.size = (long long)fs::file_size(path, ec);
+        auto stamp = fs::last_write_time(path, ec);
+        if (!ec) state.stamp = (long long)stamp.time_since_epoch().count();
+        return state;
+    }
+
+    // The file is as the engine last wrote or read it, so a change reported
+    // for it was the engine's own
+    bool unchangedOnDisk(FileID id, const DiskState& disk) {
+        FileMetadata meta;
+        return metadata->getMetadata(id, meta) && meta.disk_stamp != 0 &&
+               meta.disk_stamp == disk.stamp && meta.file_size == disk.size;
+    }
+
+    // Bring one name in line with what is actually on disk
+    void reconcile(const std::string& filename) {
+        DiskState disk = diskState(filename);
+        FileID id = registry.lookup(filename);
+
+        if (disk.present && id == INVALID_FILE_ID) {
+            id = registry.intern(filename);
+            if (trie_built) trie->insert(filename, id);
+        } else if (!disk.present && id != INVALID_FILE_ID) {
+            forgetFile(id);
+        } else if (disk.present && !unchangedOnDisk(id, disk)) {
+            invalidateContent(id); // Contents changed under us
+        }
+    }
+
+    // Without a watcher nothing reports out-of-band changes, so every command
+    // naming a file checks that file first (LIST rescans the whole directory).
+    // Only plain names in the storage directory itself are looked at.
+    void checkOnDisk(const std::string& filename) {
+        if (store || watcher.isActive()) return;
+        if (filename.empty() || filename == "." || filename == ".." || filename.find_first_of("/\\") != std::string::npos) return;
+        reconcile(filename);
+    }
+
+public:
+    // Apply out-of-band changes reported by the watcher (no syscall if there are none).
+    // Without a watcher, see checkOnDisk().
+    void syncNamespace() {
+        if (!watcher.isActive() || !watcher.pending()) return;
+
+        std::vector<std::string> names;
+        if (watcher.drain(names)) {
+            rescan();
+            return;
+        }
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        for (const std::string& name : names) {
+            reconcile(name);
+        }
+    }
+
+    // Full reconciliation against the directory
+    void rescan() {
+        std::vector<std::string> on_disk;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(storage_path, ec)) {
+            if (entry.is_regular_file()) {
+                on_disk.push_back(entry.path().filename().string());
+            }
+        }
+        std::sort(on_disk.begin(), on_disk.end());
+
+        std::vector<FileID> gone;
+        registry.forEach([&](FileID id, std::string_view name) {
+            if (!std::binary_search(on_disk.begin(), on_disk.end(), name)) gone.push_back(id);
+        });
+        for (FileID id : gone) forgetFile(id);
+
+        for (const std::string& name : on_disk) {
+            if (registry.lookup(name) == INVALID_FILE_ID) {
+                FileID id = registry.intern(name);
+                if (trie_built) trie->insert(name, id);
+            }
+        }
+    }
+
+private:
+    // --- Block cache helpers ---
+    // Files are cached as BLOCK_SIZE pieces keyed by "<file id>#<block>".
+    // Keys use the ID, so a rename doesn't invalidate anything.
+    // In dedup mode the key is the disk block ("@<block>") instead, so files
+    // sharing content share cache entries too.
+    static std::string blockKey(FileID id, size_t block) {
+        return std::to_string(id) + "#" + std::to_string(block);
+    }
+
+    static std::string storeBlockKey(long long block) {
+        return "@" + std::to_string(block);
+    }
+
+    static size_t blockCount(long long file_size) {
+        return (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    // Cache keys of a file's blocks in order; false if its layout isn't known yet
+    bool contentKeys(FileID id, std::vector<std::string>& keys) {
+        keys.clear();
+        if (store) {
+            const std::vector<long long>* recipe = store->recipe(id);
+            if (!recipe) return false;
+            for (long long block : *recipe) keys.push_back(storeBlockKey(block));
+            return true;
+        }
+
+        FileMetadata meta;
+        if (!metadata->getMetadata(id, meta)) return false;
+        for (size_t b = 0; b < blockCount(meta.file_size); ++b) keys.push_back(blockKey(id, b));
+        return true;
+    }
+
+    void cacheContent(FileID id, const std::string& content, bool prefetch) {
+        std::vector<std::string> keys;
+        if (!contentKeys(id, keys)) return;
+        for (size_t offset = 0, b = 0; offset < content.size() && b < keys.size(); offset += BLOCK_SIZE, ++b) {
+            size_t len = std::min(content.size() - offset, (size_t)BLOCK_SIZE);
+            std::vector<char> data(content.begin() + offset, content.begin() + offset + len);
+            cache->putBlock(keys[b], data, prefetch);
+        }
+    }
+
+    // Reassemble a file from the cache; false if any block is missing
+    bool readFromCache(FileID id, std::string& content) {
+        std::vector<std::string> keys;
+        if (!contentKeys(id, keys) || keys.empty()) return false;
+
+        content.clear();
+        content.reserve(keys.size() * BLOCK_SIZE);
+        CacheBlock block("", 0);
+        for (const std::string& key : keys) {
+            if (!cache->getBlock(key, block)) return false;
+            content.append(block.data.begin(), block.data.end());
+        }
+        return true;
+    }
+
+    bool isFullyCached(FileID id) {
+        std::vector<std::string> keys;
+        if (!contentKeys(id, keys) || keys.empty()) return false;
+        for (const std::string& key : keys) {
+            if (!cache->contains(key)) return false;
+        }
+        return true;
+    }
+
+    // Store blocks never change while referenced, so in dedup mode only
+    // freed blocks need dropping (see dropStoreBlocks)
+    void invalidateContent(FileID id) {
+        if (store) return;
+        std::vector<std::string> keys;
+        if (!contentKeys(id, keys)) return;
+        for (const std::string& key : keys) {
+            cache->invalidate(key);
+        }
+    }
+
+    // Freed store blocks get reused for other content
+    void dropStoreBlocks(const std::vector<long long>& freed) {
+        for (long long block : freed) {
+            cache->invalidate(storeBlockKey(block));
+        }
+    }
+
+    // 'stamp' gets the file's last_write_time from just before the read (see recordSize)
+    bool loadContent(FileID id, std::string& content, long long& stamp) {
+        stamp = 0;
+        if (store) return store->readFile(id, content);
+        std::string filename(registry.name(id));
+        stamp = diskState(filename).stamp;
+        return loadFromDisk(filename, content);
+    }
+
+    bool loadFromDisk(const std::string& filename, std::string& content) {
+        std::ifstream infile(storage_path + filename);
+        if (!infile.is_open()) return false;
+
+        std::stringstream buffer;
+        buffer << infile.rdbuf();
+        content = buffer.str();
+        CMFS_COUNT(DISK_READ_OPS, 1);
+        CMFS_COUNT(DISK_READ_BYTES, content.size());
+        return true;
+    }
+
+    void recordSize(FileID id, size_t size, long long stamp) {
+        FileMetadata meta;
+        metadata->getMetadata(id, meta);
+        meta.file_size = size;
+        meta.disk_stamp = stamp;
+        metadata->setMetadata(id, meta);
+    }
+
+    // Pull the predicted next files into the cache ahead of the request.
+    // Returns how many files were loaded.
+    size_t prefetch(const std::vector<Dependency>& predictions) {
+        size_t loaded = 0;
+        for (const Dependency& dep : predictions) {
+            if (!registry.isLive(dep.file_id) || isFullyCached(dep.file_id)) continue;
+
+            std::string content;
+            long long stamp;
+            if (!loadContent(dep.file_id, content, stamp)) continue;
+            recordSize(dep.file_id, content.size(), stamp);
+            cacheContent(dep.file_id, content, true);
+            loaded++;
+        }
+        return loaded;
+    }
+
+    // Approximate heap footprint of the forward + reverse keyword indexes
+    size_t tagIndexMemory() const {
+        size_t node = 2 * sizeof(void*);
+        size_t bytes = 0;
+        for (const auto& entry : keyword_index) {
+            bytes += sizeof(entry) + 3 * sizeof(void*) + entry.second.capacity() * sizeof(FileID);
+            if (entry.first.capacity() > 15) bytes += entry.first.capacity() + 1;
+        }
+        bytes += file_keywords.bucket_count() * sizeof(void*);
+        for (const auto& entry : file_keywords) {
+            bytes += sizeof(entry) + node + entry.second.capacity() * sizeof(std::string);
+            for (const std::string& key : entry.second) {
+                if (key.capacity() > 15) bytes += key.capacity() + 1;
+            }
+        }
+        return bytes;
+    }
+
+    // Drop every in-memory trace of a file, then release its ID for reuse
+    void forgetFile(FileID id) {
+        auto it = file_keywords.find(id);
+        if (it != file_keywords.end()) {
+            for (const std::string& key : it->second) {
+                if (keyword_index.count(key)) {
+                    std::vector<FileID>& file_list = keyword_index[key];
+                    file_list.erase(
+                        std::remove(file_list.begin(), file_list.end(), id), 
+                        file_list.end()
+                    );
+                    if (file_list.empty()) {
+                        keyword_index.erase(key);
+                    }
+                }
+            }
+            file_keywords.erase(it);
+        }
+
+        if (trie_built) trie->remove(std::string(registry.name(id)));
+        invalidateContent(id);
+        if (store) {
+            std::vector<long long> freed;
+            store->removeFile(id, registry.name(id), freed);
+            dropStoreBlocks(freed);
+        }
+        metadata->removeMetadata(id);
+        graph->removeFile(id);
+        registry.tombstone(id);
+    }
+
+    bool writeToDirectory(const std::string& filename, const std::string& content) {
+        std::ofstream outfile(storage_path + filename);
+        if (!outfile.is_open()) return false;
+        outfile << content;
+        outfile.close();
+        CMFS_COUNT(DISK_WRITE_OPS, 1);
+        CMFS_COUNT(DISK_WRITE_BYTES, content.size());
+        return true;
+    }
+
+    bool storeContent(FileID id, const std::string& filename, const std::string& content) {
+        std::vector<long long> freed;
+        bool stored = store->writeFile(id, filename, content, freed);
+        dropStoreBlocks(freed);
+        return stored;
+    }
+
+public:
+
+
+    // Command: WRITE <filename> <content>
+    void writeFile(const std::string& filename, const std::string& content) {
+        if (!validName(filename)) {
+            out << buildJSONResponse("error", "Invalid file name") << std::endl;
+            return;
+        }
+        FileID id = registry.lookup(filename);
+        bool created = (id == INVALID_FILE_ID);
+        if (created) id = registry.intern(filename);
+
+        bool stored = store ? storeContent(id, filename, content) : writeToDirectory(filename, content);
+        if (!stored) {
+            if (created) registry.tombstone(id);
+            out << buildJSONResponse("error", store ? "Storage full" : "Failed to create file") << std::endl;
+            return;
+        }
+
+        if (created && trie_built) trie->insert(filename, id);
+        invalidateContent(id);
+        FileMetadata meta;
+        meta.file_size = content.size();
+        if (!store) meta.disk_stamp = diskState(filename).stamp;
+        metadata->setMetadata(id, meta);
+
+        out << buildJSONResponse("success", "File written successfully", "\"file\": \"" + filename + "\"") << std::endl;
+    }
+
+
+    // Command: READ <filename>
+    void readFile(const std::string& filename) {
+        checkOnDisk(filename);
+        FileID id = registry.lookup(filename);
+        if (id == INVALID_FILE_ID) {
+            out << buildJSONResponse("error", "File not found") << std::endl;
+            return;
+        }
+
+        std::string content;
+        std::string source = "CACHE";
+        if (!readFromCache(id, content)) {
+            long long stamp;
+            if (!loadContent(id, content, stamp)) {
+                out << buildJSONResponse("error", "Failed to open file") << std::endl;
+                return;
+            }
+            recordSize(id, content.size(), stamp);
+            cacheContent(id, content, false);
+            source = "DISK";
+        }
+
+        std::vector<Dependency> predictions = graph->getTopDependencies(id);
+        pending_prefetch = predictions;
+        std::string prediction_json = "[";
+        std::string weight_json = "[";
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            prediction_json += "\"" + std::string(registry.name(predictions[i].file_id)) + "\"";
+            weight_json += std::to_string(predictions[i].weight);
+            if (i < predictions.size() - 1) {
+                prediction_json += ",";
+                weight_json += ",";
+            }
+        }
+        prediction_json += "]";
+        weight_json += "]";
+
+        // The tags spare the shard router a LIST when it moves the file to another shard
+        std::string tags_json = "[";
+        auto tags_it = file_keywords.find(id);
+        if (tags_it != file_keywords.end()) {
+            const auto& tags = tags_it->second;
+            for (size_t i = 0; i < tags.size(); ++i) {
+                tags_json += "\"" + tags[i] + "\"";
+                if (i < tags.size() - 1) tags_json += ",";
+            }
+        }
+        tags_json += "]";
+
+        // The weights let the shard router merge these with cross-shard predictions
+        std::string extra = "\"content\": \"" + escapeJSON(content) + "\", \"tags\": " + tags_json + ", \"source\": \"" + source + "\", \"predictions\": " + prediction_json + ", \"prediction_weights\": " + weight_json;
+        out << buildJSONResponse("success", "Read successful", extra) << std::endl;
+    }
+
+
+    // Command: ACCESS_PAIR <source> <target>
+    // Frontend tells us: "User opened A, then immediately opened B"
+    void learnRelationship(const std::string& source, const std::string& target) {
+        checkOnDisk(source);
+        checkOnDisk(target);
+        FileID source_id = registry.lookup(source);
+        FileID target_id = registry.lookup(target);
+        if (source_id == INVALID_FILE_ID || target_id == INVALID_FILE_ID) {
+            out << buildJSONResponse("error", "File not found") << std::endl;
+            return;
+        }
+        graph->updateConnection(source_id, target_id);
+        out << buildJSONResponse("success", "Relationship learned") << std::endl;
+    }
+
+    // Command: PREFETCH <filename>
+    // Warm the cache with a file another shard predicted (also answers whether it exists)
+    void prefetchFile(const std::string& filename) {
+        checkOnDisk(filename);
+        FileID id = registry.lookup(filename);
+        if (id == INVALID_FILE_ID) {
+            out << buildJSONResponse("error", "File not found") << std::endl;
+            return;
+        }
+        prefetch({Dependency{id, 0}});
+        out << buildJSONResponse("success", "Prefetched") << std::endl;
+    }
+
+    // Command: LIST <prefix>
+    // Served entirely from memory: the namespace is kept current by syncNamespace()
+    void listFiles(const std::string& prefix) {
+        if (!store && !watcher.isActive()) rescan();
+
+        std::vector<FileID> files;
+        if (prefix.empty()) {
+            files.reserve(registry.size());
+            registry.forEach([&](FileID id, std::string_view) { files.push_back(id); });
+        } else {
+            files = prefixIndex().findWithPrefix(prefix);
+        }
+        
+        std::string file_list_json = "[";
+        for (size_t i = 0; i < files.size(); ++i) {
+            file_list_json += "{\"name\":\"";
+            file_list_json += registry.name(files[i]);
+            file_list_json += "\",\"tags\":[";
+            
+            auto tags_it = file_keywords.find(files[i]);
+            if (tags_it != file_keywords.end()) {
+                const auto& tags = tags_it->second;
+                for (size_t j = 0; j < tags.size(); ++j) {
+                    file_list_json += "\"" + tags[j] + "\"";
+                    if (j < tags.size() - 1) file_list_json += ",";
+                }
+            }
+            
+            file_list_json += "]}";
+            if (i < files.size() - 1) file_list_json += ",";
+        }
+        file_list_json += "]";
+        
+        out << buildJSONResponse("success", "Directory listed", "\"files\": " + file_list_json) << std::endl;
+    }
+
+
+    // Update this inside your CognitiveDFS class in main.cpp
+    void deleteFile(const std::string& filename) {
+        checkOnDisk(filename);
+        FileID id = registry.lookup(filename);
+        if (id == INVALID_FILE_ID) {
+            out << buildJSONResponse("error", "File not found") << std::endl;
+            return;
+        }
+
+        // Remove it from disk first: if that fails the file is still there, so
+        // it must stay in the namespace too
+        if (!store) {
+            std::error_code ec;
+            fs::remove(storage_path + filename, ec);
+            if (ec) {
+                out << buildJSONResponse("error", "Failed to delete file") << std::endl;
+                return;
+            }
+        }
+        forgetFile(id);
+
+        out << buildJSONResponse("success", "File '" + filename + "' deleted") << std::endl;
+    }
+
+    void tagFile(const std::string& filename, const std::string& keyword) {
+        checkOnDisk(filename);
+        FileID id = registry.lookup(filename);
+        if (id == INVALID_FILE_ID) {
+            out << buildJSONResponse("error", "Cannot tag: File does not exist") << std::endl;
+            return;
+        }
+
+        if (!validName(keyword)) {
+            out << buildJSONResponse("error", "Invalid key") << std::endl;
+            return;
+        }
+        if (file_keywords[id].size() >= K_MAX_KEYS) {
+            out << buildJSONResponse("error", "Limit reached: Maximum " + std::to_string(K_MAX_KEYS) + " keys per file") << std::endl;
+            return;
+        }
+
+        file_keywords[id].push_back(keyword);
+        keyword_index[keyword].push_back(id);
+
+        out << buildJSONResponse("success", "Keyword '" + keyword + "' associated with " + filename) << std::endl;
+    }
+
+    // Command: RENAME <filename> <new_name>
+    // The file keeps its ID, so its tags, metadata and learned relationships survive.
+    void renameFile(const std::string& filename, const std::string& new_name) {
+        std::string filepath = storage_path + filename;
+        checkOnDisk(filename);
+        checkOnDisk(new_name); // Renaming over it replaces it
+        FileID id = registry.lookup(filename);
+        if (id == INVALID_FILE_ID) {
+            out << buildJSONResponse("error", "File not found") << std::endl;
+            return;
+        }
+        if (filename == new_name) {
+            out << buildJSONResponse("success", "File renamed", "\"file\": \"" + new_name + "\"") << std::endl;
+            return;
+        }
+        if (!validName(new_name)) {
+            out << buildJSONResponse("error", "Invalid file name") << std::endl;
+            return;
+        }
+
+        // Renaming over an existing file replaces it
+        FileID replaced = registry.lookup(new_name);
+        if (store) {
+            // The one rename record also retires the replaced file (forgetFile
+            // below then finds nothing left to journal)
+            std::vector<long long> freed;
+            if (!store->renameFile(filename, new_name, replaced, freed)) {
+                out << buildJSONResponse("error", "Failed to rename file") << std::endl;
+                return;
+            }
+            dropStoreBlocks(freed);
+        } else {
+            std::error_code ec;
+            fs::rename(filepath, storage_path + new_name, ec);
+            if (ec) {
+                out << buildJSONResponse("error", "Failed to rename file") << std::endl;
+                return;
+            }
+        }
+        if (replaced != INVALID_FILE_ID) {
+            forgetFile(replaced);
+        }
+
+        if (trie_built) trie->remove(filename);
+        registry.rename(id, new_name);
+        if (trie_built) trie->insert(new_name, id);
+
+        out << buildJSONResponse("success", "File renamed", "\"file\": \"" + new_name + "\"") << std::endl;
+    }
+
+
+    // Command: SEARCH_KEY <keyword>
+    void searchByKeyword(const std::string& keyword) {
+        if (keyword_index.find(keyword) == keyword_index.end() || keyword_index[keyword].empty()) {
+            out << buildJSONResponse("success", "No files found for this key", "\"files\": []") << std::endl;
+            return;
+        }
+
+        std::string files_json = "[";
+        auto& list = keyword_index[keyword];
+        for (size_t i = 0; i < list.size(); ++i) {
+            files_json += "\"";
+            files_json += registry.name(list[i]);
+            files_json += "\"";
+            if (i < list.size() - 1) files_json += ",";
+        }
+        files_json += "]";
+
+        out << buildJSONResponse("success", "Search complete", "\"files\": " + files_json) << std::endl;
+    }
+
+    // List the system pre-defined keywords for the UI
+    void getSystemKeywords() {
+        std::string keys = "[";
+        for (size_t i = 0; i < system_keywords.size(); ++i) {
+            keys += "\"" + system_keywords[i] + "\"";
+            if (i < system_keywords.size() - 1) keys += ",";
+        }
+        keys += "]";
+        out << buildJSONResponse("success", "System keywords fetched", "\"keywords\": " + keys) << std::endl;
+    }
+
+    void suggestKeywords(const std::string& prefix) {
+        std::string suggestions_json = "[";
+        std::vector<std::string> matches;
+
+        // Compatibility fix: use standard iterator instead of structured bindings [key, val]
+        for (auto it = keyword_index.begin(); it != keyword_index.end(); ++it) {
+            const std::string& current_keyword = it->first; 
+            
+            // Safety check: ensure prefix isn't longer than the keyword itself
+            if (prefix.size() <= current_keyword.size()) {
+                if (current_keyword.substr(0, prefix.size()) == prefix) {
+                    matches.push_back(current_keyword);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < matches.size(); ++i) {
+            suggestions_json += "\"" + matches[i] + "\"";
+            if (i < matches.size() - 1) suggestions_json += ",";
+        }
+        suggestions_json += "]";
+
+        out << buildJSONResponse("success", "Suggestions fetched", "\"suggestions\": " + suggestions_json) << std::endl;
+    }
+
+    // Counters, latency percentiles, cache occupancy and per-structure memory
+    std::string statsJSON() const {
+        std::string json = "\"metrics_enabled\": " + std::string(CMFS_METRICS_ENABLED ? "true" : "false") + ", ";
+        json += Metrics::toJSON();
+        json += ", \"cache\": {\"blocks\": " + std::to_string(cache->size());
+        json += ", \"capacity\": " + std::to_string(cache->capacity());
+        json += ", \"compressed_blocks\": " + std::to_string(cache->compressedSize());
+        json += ", \"compressed_bytes\": " + std::to_string(cache->compressedBytes());
+        json += ", \"compressed_budget\": " + std::to_string(cache->compressedBudget()) + "}";
+        if (store) {
+            json += ", \"dedup\": {\"logical_bytes\": " + std::to_string(store->logicalBytes());
+            json += ", \"stored_bytes\": " + std::to_string(store->storedBytes());
+            json += ", \"blocks_used\": " + std::to_string(store->blocksUsed());
+            json += ", \"capacity_blocks\": " + std::to_string(store->capacityBlocks());
+            json += ", \"ratio\": " + std::to_string(store->dedupRatio()) + "}";
+        }
+        json += ", \"files\": " + std::to_string(registry.size());
+        json += ", \"memory_bytes\": {";
+        json += "\"registry\": " + std::to_string(registry.memoryUsage());
+        json += ", \"trie\": " + std::to_string(trie->memoryUsage());
+        json += ", \"metadata\": " + std::to_string(metadata->memoryUsage());
+        json += ", \"tags\": " + std::to_string(tagIndexMemory());
+        json += ", \"graph\": " + std::to_string(graph->memoryUsage());
+        json += ", \"cache\": " + std::to_string(cache->memoryUsage());
+        if (store) json += ", \"content_store\": " + std::to_string(store->memoryUsage());
+        json += "}";
+        return json;
+    }
+
+    // Command: STATS
+    void printStats() {
+        out << buildJSONResponse("success", "Stats collected", statsJSON()) << std::endl;
+    }
+
+    // Load what the last READ predicted. Callers run this after execute() has
+    // written the response, so the disk reads overlap the client's next step
+    // instead of adding to the READ (and its latency histogram).
+    size_t runPrefetch() {
+        std::vector<Dependency> predictions;
+        predictions.swap(pending_prefetch);
+        return prefetch(predictions);
+    }
+    // Parse one protocol line (JSON from the Node bridge) and run it
+    void execute(std::string line) {
+        // Clean the line: remove any carriage returns (\r) from Windows
+        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+        if (line.empty()) return;
+
+        pending_prefetch.clear(); // Not run before this command; the IDs may be stale now
+        syncNamespace();
+
+        switch (protocolAction(line)) {
+        // 1. WRITE (the keyword is matched anywhere in the JSON)
+        case ACTION_WRITE: {
+            CMFS_TIME_COMMAND(CMD_WRITE);
+            std::string filename = extractField(line, "file");
+            std::string content = extractField(line, "data");
+            writeFile(filename, content);
+            break;
+        }
+        case ACTION_STATS: {
+            CMFS_TIME_COMMAND(CMD_STATS);
+            printStats();
+            break;
+        }
+        case ACTION_RENAME: {
+            CMFS_TIME_COMMAND(CMD_RENAME);
+            renameFile(extractField(line, "file"), extractField(line, "to"));
+            break;
+        }
+        case ACTION_ACCESS_PAIR: {
+            CMFS_TIME_COMMAND(CMD_ACCESS_PAIR);
+            learnRelationship(extractField(line, "source"), extractField(line, "target"));
+            break;
+        }
+        case ACTION_PREFETCH: {
+            CMFS_TIME_COMMAND(CMD_PREFETCH);
+            prefetchFile(extractField(line, "file"));
+            break;
+        }
+        // 2. READ
+        case ACTION_READ: {
+            CMFS_TIME_COMMAND(CMD_READ);
+            readFile(extractField(line, "file"));
+            break;
+        }
+        // 3. LIST
+        case ACTION_LIST: {
+            CMFS_TIME_COMMAND(CMD_LIST);
+            listFiles("");
+            break;
+        }
+        case ACTION_DELETE: {
+            CMFS_TIME_COMMAND(CMD_DELETE);
+            if (expectsResponse(ACTION_DELETE, line)) {
+                deleteFile(extractField(line, "file"));
+            }
+            break;
+        }
+        case ACTION_TAG: {
+            CMFS_TIME_COMMAND(CMD_TAG);
+            tagFile(extractField(line, "file"), extractField(line, "key"));
+            break;
+        }
+        case ACTION_SEARCH_KEY: {
+            CMFS_TIME_COMMAND(CMD_SEARCH_KEY);
+            searchByKeyword(extractField(line, "key"));
+            break;
+        }
+        case ACTION_SUGGEST_KEYS: {
+            CMFS_TIME_COMMAND(CMD_SUGGEST_KEYS);
+            if (expectsResponse(ACTION_SUGGEST_KEYS, line)) {
+                suggestKeywords(extractField(line, "prefix"));
+            }
+            break;
+        }
+        default:
+            // This tells us exactly what the C++ received so we can fix it
+            out << unknownCommandResponse(line) << std::endl;
+        }
+
+        if (store && store->journalFull()) store->save(registry);
+    }
+};
+
+#endif
@@ -0,0 +1,527 @@
+#ifndef CONTENTSTORE_H
+#define CONTENTSTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "FileRegistry.h"
+#include "VirtualDisk.h"
+#include "Metrics.h"
+
+// 64-bit fingerprint of a block (word-at-a-time multiply/xor-shift mix)
+inline uint64_t fingerprintBlock(const char* data, size_t len) {
+    const uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t h = len * K;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * K;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, len - i);
+    h = (h ^ tail) * K;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// Content-addressed block store inside a VirtualDisk image.
+// A file is a recipe: the disk blocks holding its BLOCK_SIZE pieces in order.
+// Each distinct piece is written once and shared by every recipe containing it;
+// a reference count frees the block when the last recipe lets go. A fingerprint
+// match is confirmed byte for byte before sharing, so a collision only costs a
+// duplicate block, never wrong data.
+// The block table and recipes are kept in memory, snapshotted to
+// "<image>.index" and journaled to "<image>.journal" (see Persistence).
+class ContentStore {
+private:
+    struct BlockInfo {
+        uint64_t fingerprint;
+        uint32_t refs;   // 0 = free
+        uint32_t length; // Used bytes (the last piece of a file is short)
+    };
+
+    VirtualDisk disk;
+    std::string index_path;
+    std::string journal_path;
+    std::ofstream journal;
+    size_t journal_bytes = 0;
+    uint64_t generation = 0;
+    long long total_blocks;
+    std::vector<BlockInfo> blocks; // Index is the disk block; grows up to total_blocks
+    std::vector<long long> free_blocks;
+    std::unordered_multimap<uint64_t, long long> by_fingerprint;
+    std::unordered_map<FileID, std::vector<long long>> recipes;
+    uint64_t logical_bytes = 0; // Sum of file sizes
+    uint64_t stored_bytes = 0;  // Sum of distinct block lengths
+
+    long long allocate() {
+        if (!free_blocks.empty()) {
+            long long block = free_blocks.back();
+            free_blocks.pop_back();
+            return block;
+        }
+        if ((long long)blocks.size() >= total_blocks) return -1;
+        blocks.push_back(BlockInfo{0, 0, 0});
+        return (long long)blocks.size() - 1;
+    }
+
+    bool sameContent(long long block, const char* data, size_t len) {
+        if (blocks[block].length != len) return false;
+        std::vector<char> buffer;
+        if (!disk.readBlock(block, buffer)) return false;
+        return std::memcmp(buffer.data(), data, len) == 0;
+    }
+
+    // Store one piece and return its block (an existing one if the content is already there).
+    // -1 when the image is full.
+    long long put(const char* data, size_t len) {
+        uint64_t fingerprint = fingerprintBlock(data, len);
+        auto range = by_fingerprint.equal_range(fingerprint);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (sameContent(it->second, data, len)) {
+                blocks[it->second].refs++;
+                CMFS_COUNT(DEDUP_HITS, 1);
+                return it->second;
+            }
+        }
+
+        long long block = allocate();
+        if (block < 0) return -1;
+        if (!disk.writeBlock(block, std::vector<char>(data, data + len))) {
+            free_blocks.push_back(block);
+            return -1;
+        }
+        blocks[block] = BlockInfo{fingerprint, 1, (uint32_t)len};
+        by_fingerprint.emplace(fingerprint, block);
+        stored_bytes += len;
+        return block;
+    }
+
+    // Drop one reference. A block that becomes free is appended to 'freed'.
+    void release(long long block, std::vector<long long>& freed) {
+        BlockInfo& info = blocks[block];
+        if (info.refs == 0 || --info.refs > 0) return;
+
+        auto range = by_fingerprint.equal_range(info.fingerprint);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == block) {
+                by_fingerprint.erase(it);
+                break;
+            }
+        }
+        stored_bytes -= info.length;
+        info.length = 0;
+        free_blocks.push_back(block);
+        freed.push_back(block);
+    }
+
+    void dropRecipe(FileID id, std::vector<long long>& freed) {
+        auto it = recipes.find(id);
+        if (it == recipes.end()) return;
+        logical_bytes -= recipeSize(it->second);
+        for (long long block : it->second) release(block, freed);
+        recipes.erase(it);
+    }
+
+    uint64_t recipeSize(const std::vector<long long>& recipe) const {
+        uint64_t size = 0;
+        for (long long block : recipe) size += blocks[block].length;
+        return size;
+    }
+
+public:
+    ContentStore(const std::string& image_path, long long num_blocks)
+        : disk(image_path, num_blocks), index_path(image_path + ".index"), journal_path(image_path + ".journal"),
+          total_blocks(num_blocks) {}
+
+    // 1. Replace a file's contents. Returns false (old contents kept) if the image
+    //    is full or the change can't be journaled.
+    //    Blocks nobody references any more are appended to 'freed'.
+    bool writeFile(FileID id, std::string_view name, const std::string& content, std::vector<long long>& freed) {
+        std::vector<long long> recipe;
+        recipe.reserve((content.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        for (size_t offset = 0; offset < content.size(); offset += BLOCK_SIZE) {
+            size_t len = std::min(content.size() - offset, (size_t)BLOCK_SIZE);
+            long long block = put(content.data() + offset, len);
+            if (block < 0) {
+                for (long long b : recipe) release(b, freed);
+                return false;
+            }
+            recipe.push_back(block);
+        }
+        if (!append(writeRecord(name, recipe))) {
+            for (long long b : recipe) release(b, freed);
+            return false;
+        }
+
+        // Release the old recipe last, so pieces it shares with the new one are kept
+        auto it = recipes.find(id);
+        if (it != recipes.end()) {
+            logical_bytes -= recipeSize(it->second);
+            for (long long b : it->second) release(b, freed);
+            it->second.swap(recipe);
+        } else {
+            recipes.emplace(id, std::move(recipe));
+        }
+        logical_bytes += content.size();
+        return true;
+    }
+
+    // 2. Reassemble a file from its blocks
+    bool readFile(FileID id, std::string& content) {
+        auto it = recipes.find(id);
+        if (it == recipes.end()) return false;
+
+        content.clear();
+        content.reserve(it->second.size() * BLOCK_SIZE);
+        std::vector<char> buffer;
+        for (long long block : it->second) {
+            if (!disk.readBlock(block, buffer)) return false;
+            content.append(buffer.data(), blocks[block].length);
+        }
+        return true;
+    }
+
+    // 3. Forget a file; blocks that become free are appended to 'freed'
+    void removeFile(FileID id, std::string_view name, std::vector<long long>& freed) {
+        if (!recipes.count(id)) return;
+        // If this fails and the blocks are reused, load()'s fingerprint check drops the file
+        append("D\n" + std::string(name) + "\n");
+        dropRecipe(id, freed);
+    }
+
+    // 4. Recipes are keyed by ID, so a rename only needs journaling. A file
+    //    already called new_name ('replaced') is released only once the record
+    //    is down: replaying it replaces that file too. False (nothing changed)
+    //    if it can't be journaled.
+    bool renameFile(std::string_view name, std::string_view new_name, FileID replaced, std::vector<long long>& freed) {
+        if (!append("R\n" + std::string(name) + "\n" + std::string(new_name) + "\n")) return false;
+        if (replaced != INVALID_FILE_ID) dropRecipe(replaced, freed);
+        return true;
+    }
+
+    // The disk blocks of a file in order (nullptr if unknown)
+    const std::vector<long long>* recipe(FileID id) const {
+        auto it = recipes.find(id);
+        return it == recipes.end() ? nullptr : &it->second;
+    }
+
+    bool contains(FileID id) const { return recipes.count(id) > 0; }
+
+    uint64_t logicalBytes() const { return logical_bytes; }
+    uint64_t storedBytes() const { return stored_bytes; }
+    size_t blocksUsed() const { return blocks.size() - free_blocks.size(); }
+    long long capacityBlocks() const { return total_blocks; }
+
+    // Logical bytes per stored byte (1.0 = nothing shared)
+    double dedupRatio() const {
+        return stored_bytes ? (double)logical_bytes / stored_bytes : 1.0;
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = blocks.capacity() * sizeof(BlockInfo) + free_blocks.capacity() * sizeof(long long);
+        bytes += by_fingerprint.bucket_count() * sizeof(void*) + by_fingerprint.size() * (sizeof(std::pair<uint64_t, long long>) + sizeof(void*));
+        bytes += recipes.bucket_count() * sizeof(void*);
+        for (const auto& entry : recipes) {
+            bytes += sizeof(entry) + sizeof(void*) + entry.second.capacity() * sizeof(long long);
+        }
+        return bytes;
+    }
+
+    // --- Persistence ---
+    // The index is a snapshot, rewritten by save() at startup, at shutdown and
+    // whenever the journal passes JOURNAL_LIMIT bytes. Every write, delete and
+    // rename in between is appended to the journal before it is acknowledged,
+    // and a block is only reused after the record that freed it, so after a
+    // crash index + journal describe exactly what was answered. Both carry a
+    // generation; a journal only applies to the index of the same generation.
+    //
+    // <image>.index
+    //   CMFS-CAS 2 <table size> <live blocks> <files> <generation>
+    //   <block> <fingerprint> <length>                 (one line per live block)
+    //   <n> <block 1> ... <block n>                    (per file, followed by its name on the next line)
+    // <image>.journal
+    //   CMFS-JOURNAL <generation>
+    //   W <n> <block> <fingerprint> <length> ...      (file written, then its name)
+    //   D                                              (file removed, then its name)
+    //   R                                              (file renamed, then old and new name)
+    static const size_t JOURNAL_LIMIT = 8 * 1024 * 1024;
+
+    bool save(const FileRegistry& registry) {
+        std::string tmp_path = index_path + ".tmp";
+        std::ofstream outfile(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!outfile.is_open()) return false;
+
+        uint64_t next = generation + 1;
+        size_t files = 0;
+        registry.forEach([&](FileID id, std::string_view) { files += recipes.count(id); });
+        outfile << "CMFS-CAS 2 " << blocks.size() << " " << blocksUsed() << " " << files << " " << next << "\n";
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (blocks[b].refs > 0) outfile << b << " " << blocks[b].fingerprint << " " << blocks[b].length << "\n";
+        }
+        registry.forEach([&](FileID id, std::string_view name) {
+            auto it = recipes.find(id);
+            if (it == recipes.end()) return;
+            outfile << it->second.size();
+            for (long long block : it->second) outfile << " " << block;
+            outfile << "\n" << name << "\n";
+        });
+        outfile.close();
+        if (!outfile) return false;
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, index_path, ec);
+        if (ec) return false;
+        generation = next; // The old journal no longer applies from here on
+        return resetJournal();
+    }
+
+    // Rebuild the block table and recipes from the index and journal, interning
+    // every file into 'registry', then save a fresh snapshot.
+    // True for a new store. False if the saved state can't be used: the caller
+    // must not carry on (and save over it).
+    bool load(FileRegistry& registry) {
+        Snapshot snapshot;
+        std::error_code ec;
+        bool has_index = std::filesystem::exists(index_path, ec);
+        if ((has_index && !readIndex(snapshot)) || !replayJournal(snapshot, has_index)) {
+            std::cerr << "[CAS] Cannot use " << index_path << " / " << journal_path << "; left untouched" << std::endl;
+            return false;
+        }
+        verifyBlocks(snapshot);
+        install(snapshot, registry);
+        return save(registry);
+    }
+
+    // Checkpoint due (the caller has the registry save() needs)
+    bool journalFull() const { return journal_bytes > JOURNAL_LIMIT; }
+
+private:
+    // What the index and journal describe, before it is installed
+    struct Snapshot {
+        std::vector<BlockInfo> table; // refs are recomputed by install()
+        std::vector<bool> present;
+        std::unordered_map<std::string, std::vector<long long>> files;
+        uint64_t generation = 0;
+
+        void setBlock(long long block, uint64_t fingerprint, uint32_t length) {
+            if ((size_t)block >= table.size()) {
+                table.resize(block + 1, BlockInfo{0, 0, 0});
+                present.resize(block + 1, false);
+            }
+            table[block] = BlockInfo{fingerprint, 0, length};
+            present[block] = true;
+        }
+    };
+
+    bool readIndex(Snapshot& snapshot) {
+        std::ifstream infile(index_path, std::ios::binary);
+        if (!infile.is_open()) return false;
+
+        std::string line;
+        size_t table_size = 0, live = 0, files = 0;
+        unsigned long long saved_generation = 0;
+        if (!std::getline(infile, line) ||
+            std::sscanf(line.c_str(), "CMFS-CAS 2 %zu %zu %zu %llu", &table_size, &live, &files, &saved_generation) != 4) {
+            return false;
+        }
+        if ((long long)table_size > total_blocks) {
+            std::cerr << "[CAS] The index uses " << table_size << " blocks but the image is sized for "
+                      << total_blocks << " (CMFS_DEDUP_BLOCKS)" << std::endl;
+            return false;
+        }
+        snapshot.generation = saved_generation;
+
+        for (size_t i = 0; i < live; ++i) {
+            long long block;
+            uint64_t fingerprint;
+            uint32_t length;
+            if (!(infile >> block >> fingerprint >> length) || block < 0 || (size_t)block >= table_size || length > (uint32_t)BLOCK_SIZE) return false;
+            snapshot.setBlock(block, fingerprint, length);
+        }
+
+        for (size_t f = 0; f < files; ++f) {
+            size_t count;
+            if (!(infile >> count)) return false;
+            std::vector<long long> recipe(count);
+            for (long long& block : recipe) {
+                if (!(infile >> block) || block < 0 || (size_t)block >= snapshot.present.size() || !snapshot.present[block]) return false;
+            }
+            infile.ignore(1, '\n');
+            std::string name;
+            if (!std::getline(infile, name) || name.empty()) return false;
+            snapshot.files[name] = std::move(recipe);
+        }
+        return true;
+    }
+
+    // A name line of a journal record; false if the record was cut short
+    static bool readName(std::istream& in, std::string& name) {
+        return std::getline(in, name) && !in.eof() && !name.empty();
+    }
+
+    // Apply the journal on top of the index. Replay stops at a torn record (a
+    // crash while appending), which was never acknowledged.
+    bool replayJournal(Snapshot& snapshot, bool has_index) {
+        std::ifstream infile(journal_path, std::ios::binary);
+        if (!infile.is_open()) return true;
+
+        std::string line;
+        unsigned long long journal_generation = 0;
+        if (!std::getline(infile, line) || std::sscanf(line.c_str(), "CMFS-JOURNAL %llu", &journal_generation) != 1) return false;
+        if (journal_generation != snapshot.generation) {
+            // Older than the index (already folded into it); or the index is missing
+            return has_index;
+        }
+
+        size_t applied = 0;
+        while (std::getline(infile, line) && !infile.eof()) {
+            std::string name, new_name;
+            if (line == "D") {
+                if (!readName(infile, name)) break;
+                snapshot.files.erase(name);
+            } else if (line == "R") {
+                if (!readName(infile, name) || !readName(infile, new_name)) break;
+                auto it = snapshot.files.find(name);
+                if (it != snapshot.files.end()) {
+                    std::vector<long long> recipe = std::move(it->second);
+                    snapshot.files.erase(it);
+                    snapshot.files[new_name] = std::move(recipe);
+                }
+            } else if (line.rfind("W ", 0) == 0) {
+                std::istringstream fields(line.substr(2));
+                size_t count;
+                if (!(fields >> count)) break;
+                std::vector<BlockInfo> infos(count);
+                std::vector<long long> recipe(count);
+                bool valid = true;
+                for (size_t i = 0; i < count && valid; ++i) {
+                    valid = (bool)(fields >> recipe[i] >> infos[i].fingerprint >> infos[i].length) &&
+                            recipe[i] >= 0 && recipe[i] < total_blocks && infos[i].length <= (uint32_t)BLOCK_SIZE;
+                }
+                if (!valid || !readName(infile, name)) break;
+                for (size_t i = 0; i < count; ++i) snapshot.setBlock(recipe[i], infos[i].fingerprint, infos[i].length);
+                snapshot.files[name] = std::move(recipe);
+            } else {
+                break;
+            }
+            applied++;
+        }
+        if (applied > 0) std::cerr << "[CAS] Replayed " << applied << " journal records" << std::endl;
+        return true;
+    }
+
+    // Read every referenced block back and check its fingerprint. A file using
+    // a block whose bytes don't match is dropped rather than served wrong.
+    void verifyBlocks(Snapshot& snapshot) {
+        std::vector<char> state(snapshot.table.size(), 0); // 0 unchecked, 1 good, 2 bad
+        std::vector<char> buffer;
+        for (auto it = snapshot.files.begin(); it != snapshot.files.end(); ) {
+            bool good = true;
+            for (long long block : it->second) {
+                if (state[block] == 0) {
+                    const BlockInfo& info = snapshot.table[block];
+                    bool match = disk.readBlock(block, buffer) && fingerprintBlock(buffer.data(), info.length) == info.fingerprint;
+                    state[block] = match ? 1 : 2;
+                }
+                if (state[block] == 2) {
+                    good = false;
+                    break;
+                }
+            }
+            if (good) {
+                ++it;
+            } else {
+                std::cerr << "[CAS] Dropping " << it->first << ": its blocks don't match their fingerprints" << std::endl;
+                it = snapshot.files.erase(it);
+            }
+        }
+    }
+
+    // Make the snapshot the live state. Reference counts come from the recipes.
+    void install(Snapshot& snapshot, FileRegistry& registry) {
+        blocks.swap(snapshot.table);
+        recipes.clear();
+        recipes.reserve(snapshot.files.size());
+        for (auto& file : snapshot.files) {
+            for (long long block : file.second) blocks[block].refs++;
+            recipes[registry.intern(file.first)] = std::move(file.second);
+        }
+        generation = snapshot.generation;
+
+        free_blocks.clear();
+        by_fingerprint.clear();
+        logical_bytes = stored_bytes = 0;
+        for (size_t b = blocks.size(); b-- > 0; ) {
+            if (blocks[b].refs == 0) {
+                blocks[b].length = 0;
+                free_blocks.push_back((long long)b);
+            } else {
+                by_fingerprint.emplace(blocks[b].fingerprint, (long long)b);
+                stored_bytes += blocks[b].length;
+            }
+        }
+        for (const auto& entry : recipes) logical_bytes += recipeSize(entry.second);
+    }
+
+    // Start an empty journal for the current generation
+    bool resetJournal() {
+        journal.close();
+        std::string tmp_path = journal_path + ".tmp";
+        {
+            std::ofstream outfile(tmp_path, std::ios::binary | std::ios::trunc);
+            outfile << "CMFS-JOURNAL " << generation << "\n";
+            outfile.close();
+            if (!outfile) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, journal_path, ec);
+        if (ec) return false;
+        journal.open(journal_path, std::ios::binary | std::ios::app);
+        journal_bytes = 0;
+        return journal.is_open();
+    }
+
+    // One record per call, flushed before the change is acknowledged
+    bool append(const std::string& record) {
+        if (!journal.is_open()) return false; // load() was never called
+        journal.write(record.data(), record.size());
+        journal.flush();
+        if (!journal) {
+            journal.clear();
+            std::cerr << "[CAS] Journal write failed: " << journal_path << std::endl;
+            return false;
+        }
+        journal_bytes += record.size();
+        return true;
+    }
+
+    std::string writeRecord(std::string_view name, const std::vector<long long>& recipe) const {
+        std::string record = "W " + std::to_string(recipe.size());
+        for (long long block : recipe) {
+            record += " " + std::to_string(block) + " " + std::to_string(blocks[block].fingerprint) + " " + std::to_string(blocks[block].length);
+        }
+        record += "\n";
+        record.append(name);
+        record += "\n";
+        return record;
+    }
+
+public:
+    const std::string& indexPath() const { return index_path; }
+};
+
+#endif
@@ -1,12 +1,17 @@
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <iostream>
 
+#include "FileRegistry.h"
+
 // Represents a connection to a related file
 struct Dependency {
-    std::string file_id;
+    FileID file_id;
     int weight; // Strength of the relationship
 
     // Operator for sorting (descending order of weight)
@@ -21,16 +26,31 @@ private:
     // Key: Source File ID
     // Value: map<Target File ID, Weight>
     // We use a nested map for O(1) lookups when updating weights.
-    std::unordered_map<std::string, std::unordered_map<std::string, int>> adj_map;
+    std::unordered_map<FileID, std::unordered_map<FileID, int>> adj_map;
+    // Reverse index: Target File ID -> the sources with an edge to it,
+    // so dropping a file only touches its own edges
+    std::unordered_map<FileID, std::vector<FileID>> incoming;
+
+    void unlinkIncoming(FileID source, FileID target) {
+        auto it = incoming.find(target);
+        if (it == incoming.end()) return;
+        std::vector<FileID>& sources = it->second;
+        auto pos = std::find(sources.begin(), sources.end(), source);
+        if (pos != sources.end()) {
+            *pos = sources.back(); // Order doesn't matter
+            sources.pop_back();
+        }
+        if (sources.empty()) incoming.erase(it);
+    }
 
 public:
     // 1. "Learn" a pattern: Record that 'target' was accessed after 'source'
-    void updateConnection(const std::string& source, const std::string& target) {
+    void updateConnection(FileID source, FileID target) {
         if (source == target) return; // Ignore self-loops
 
         // Increment the weight of the edge (Source -> Target)
         // If it doesn't exist, this creates it with value 0 then increments to 1
-        adj_map[source][target]++;
+        if (adj_map[source][target]++ == 0) incoming[target].push_back(source);
 
         // Optional: Debug log
         // std::cout << "[Graph] strengthened link: " << source << " -> " << target 
@@ -38,7 +58,7 @@ public:
     }
 
     // 2. "Predict": Get a list of files related to 'source', sorted by probability
-    std::vector<Dependency> getTopDependencies(const std::string& source, int limit = 3) {
+    std::vector<Dependency> getTopDependencies(FileID source, int limit = 3) {
         std::vector<Dependency> predictions;
 
         // Check if source exists in graph
@@ -74,6 +94,7 @@ public:
             for (auto it = edges.begin(); it != edges.end(); ) {
                 it->second--; // Decrease weight
                 if (it->second <= 0) {
+                    unlinkIncoming(src_pair.first, it->first);
                     it = edges.erase(it); // Remove link if weight drops to 0
                 } else {
                     ++it;
@@ -81,4 +102,42 @@ public:
             }
         }
     }
-};
\ No newline at end of file
+
+    // 4. Drop a deleted file: its outgoing edges and every edge pointing at it
+    //    Both directions come from the indexes, so the cost is the file's own degree
+    void removeFile(FileID file_id) {
+        auto out = adj_map.find(file_id);
+        if (out != adj_map.end()) {
+            for (const auto& edge : out->second) unlinkIncoming(file_id, edge.first);
+            adj_map.erase(out);
+        }
+
+        auto in = incoming.find(file_id);
+        if (in == incoming.end()) return;
+        for (FileID source : in->second) {
+            auto src = adj_map.find(source);
+            if (src == adj_map.end()) continue;
+            src->second.erase(file_id);
+            if (src->second.empty()) adj_map.erase(src);
+        }
+        incoming.erase(in);
+    }
+
+    // Approximate heap footprint of both map levels and the reverse index
+    size_t memoryUsage() const {
+        size_t node = 2 * sizeof(void*);
+        size_t bytes = adj_map.bucket_count() * sizeof(void*);
+        for (const auto& src_pair : adj_map) {
+            bytes += sizeof(src_pair) + node;
+            bytes += src_pair.second.bucket_count() * sizeof(void*);
+            bytes += src_pair.second.size() * (sizeof(std::pair<const FileID, int>) + node);
+        }
+        bytes += incoming.bucket_count() * sizeof(void*);
+        for (const auto& target : incoming) {
+            bytes += sizeof(target) + node + target.second.capacity() * sizeof(FileID);
+        }
+        return bytes;
+    }
+};
+
+#endif
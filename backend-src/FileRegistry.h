@@ -0,0 +1,261 @@
+#ifndef FILEREGISTRY_H
+#define FILEREGISTRY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <cstring>
+
+// Dense 32-bit handle for a file. Every in-memory structure keys on this
+// instead of the filename; strings only appear at the protocol boundary.
+using FileID = uint32_t;
+const FileID INVALID_FILE_ID = UINT32_MAX;
+
+class FileRegistry {
+private:
+    // ID -> Name. All names live back to back in one arena; an entry is a slice of it.
+    struct Entry {
+        uint64_t offset;
+        uint32_t length;
+        bool live;
+    };
+    std::string arena;
+    std::vector<Entry> entries; // Index is the ID
+    std::vector<FileID> free_ids; // Tombstoned IDs, reused by intern
+    size_t dead_bytes = 0;        // Arena bytes no live entry points at (renamed/deleted names)
+
+    // Name -> ID: open addressing with linear probing over (hash, id) slots
+    struct Slot {
+        uint32_t hash;
+        FileID id; // EMPTY_SLOT / DELETED_SLOT or a real ID
+    };
+    static const FileID EMPTY_SLOT = UINT32_MAX;
+    static const FileID DELETED_SLOT = UINT32_MAX - 1;
+    std::vector<Slot> table;
+    size_t used_slots = 0; // Live + deleted, drives resizing
+    size_t live_count = 0;
+
+    static uint32_t hashName(std::string_view name) {
+        return (uint32_t)std::hash<std::string_view>()(name);
+    }
+
+    std::string_view view(const Entry& e) const {
+        return std::string_view(arena.data() + e.offset, e.length);
+    }
+
+    // Index of the slot holding 'name', or of the first free slot where it would go
+    size_t findSlot(std::string_view name, uint32_t hash) const {
+        size_t mask = table.size() - 1;
+        size_t reusable = SIZE_MAX;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            const Slot& slot = table[i];
+            if (slot.id == EMPTY_SLOT) return reusable != SIZE_MAX ? reusable : i;
+            if (slot.id == DELETED_SLOT) {
+                if (reusable == SIZE_MAX) reusable = i;
+            } else if (slot.hash == hash && view(entries[slot.id]) == name) {
+                return i;
+            }
+        }
+    }
+
+    void rehash(size_t min_capacity) {
+        size_t capacity = 16;
+        while (capacity < min_capacity * 10 / 7 + 1) capacity <<= 1;
+
+        std::vector<Slot> old;
+        old.swap(table);
+        table.assign(capacity, Slot{0, EMPTY_SLOT});
+        used_slots = 0;
+        for (const Slot& slot : old) {
+            if (slot.id == EMPTY_SLOT || slot.id == DELETED_SLOT) continue;
+            size_t i = slot.hash & (capacity - 1);
+            while (table[i].id != EMPTY_SLOT) i = (i + 1) & (capacity - 1);
+            table[i] = slot;
+            used_slots++;
+        }
+    }
+
+    // Copy the live names into a fresh arena, dropping abandoned bytes
+    void compact() {
+        std::string packed;
+        packed.reserve(arena.size() - dead_bytes);
+        for (Entry& e : entries) {
+            if (!e.live) continue;
+            uint64_t offset = packed.size();
+            packed.append(arena, e.offset, e.length);
+            e.offset = offset;
+        }
+        arena.swap(packed);
+        dead_bytes = 0;
+    }
+
+    // Deletes and renames leave deleted slots behind, so churn ends up here
+    // too; that is when the arena is compacted if it is mostly garbage.
+    void growIfNeeded() {
+        if ((used_slots + 1) * 10 > table.size() * 7) {
+            if (dead_bytes * 2 > arena.size()) compact();
+            rehash(live_count + 1);
+        }
+    }
+
+    void insertSlot(std::string_view name, uint32_t hash, FileID id) {
+        growIfNeeded();
+        size_t i = findSlot(name, hash);
+        if (table[i].id == EMPTY_SLOT) used_slots++;
+        table[i] = Slot{hash, id};
+    }
+
+    void eraseSlot(std::string_view name) {
+        if (table.empty()) return;
+        size_t i = findSlot(name, hashName(name));
+        if (table[i].id != EMPTY_SLOT && table[i].id != DELETED_SLOT) {
+            table[i].id = DELETED_SLOT;
+        }
+    }
+
+public:
+    // 1. Get the ID for a filename, assigning the next dense ID if it is new
+    FileID intern(std::string_view filename) {
+        growIfNeeded();
+        uint32_t hash = hashName(filename);
+        size_t i = findSlot(filename, hash);
+        if (table[i].id != EMPTY_SLOT && table[i].id != DELETED_SLOT) {
+            return table[i].id;
+        }
+
+        FileID id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            free_ids.pop_back();
+            entries[id] = Entry{arena.size(), (uint32_t)filename.size(), true};
+        } else {
+            id = static_cast<FileID>(entries.size());
+            entries.push_back(Entry{arena.size(), (uint32_t)filename.size(), true});
+        }
+        arena.append(filename);
+        if (table[i].id == EMPTY_SLOT) used_slots++;
+        table[i] = Slot{hash, id};
+        live_count++;
+        return id;
+    }
+
+    // 2. Look up an existing file without creating it
+    FileID lookup(std::string_view filename) const {
+        if (table.empty()) return INVALID_FILE_ID;
+        const Slot& slot = table[findSlot(filename, hashName(filename))];
+        return (slot.id == EMPTY_SLOT || slot.id == DELETED_SLOT) ? INVALID_FILE_ID : slot.id;
+    }
+
+    // 3. Convert back to a string (only needed when building responses).
+    //    The view is invalidated by the next intern/rename (the arena may be compacted).
+    std::string_view name(FileID id) const {
+        return view(entries[id]);
+    }
+
+    bool isLive(FileID id) const {
+        return id < entries.size() && entries[id].live;
+    }
+
+    // 4. Rename keeps the ID stable, so tags, metadata and graph edges follow the file
+    bool rename(FileID id, std::string_view new_name) {
+        if (!isLive(id) || lookup(new_name) != INVALID_FILE_ID) return false;
+
+        eraseSlot(name(id));
+        dead_bytes += entries[id].length; // The old bytes are abandoned until the next compaction
+        entries[id].offset = arena.size();
+        entries[id].length = (uint32_t)new_name.size();
+        arena.append(new_name);
+        insertSlot(new_name, hashName(new_name), id);
+        return true;
+    }
+
+    // 5. Delete tombstones the ID and gives it back for reuse by a later intern,
+    //    so every structure holding it must drop it first (CognitiveDFS::forgetFile).
+    void tombstone(FileID id) {
+        if (!isLive(id)) return;
+
+        eraseSlot(name(id));
+        dead_bytes += entries[id].length;
+        entries[id] = Entry{0, 0, false};
+        free_ids.push_back(id);
+        live_count--;
+    }
+
+    size_t size() const { return live_count; }
+
+    // Bulk load for startup: 'buffer' holds newline-separated names from 'start'
+    // on and becomes the arena as-is. Only valid on an empty registry.
+    void loadNames(std::string&& buffer, size_t start) {
+        if (!entries.empty()) return;
+        arena = std::move(buffer);
+
+        const char* base = arena.data();
+        const char* p = base + start;
+        const char* end = base + arena.size();
+        while (p < end) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!eol) eol = end;
+            if (eol > p) entries.push_back(Entry{(uint64_t)(p - base), (uint32_t)(eol - p), false});
+            p = eol + 1;
+        }
+
+        // Insert in bucket order (counting sort on the top bits of the home slot)
+        // so the probes sweep the table sequentially instead of missing cache
+        // on every name.
+        rehash(entries.size());
+        size_t mask = table.size() - 1;
+        int shift = 0;
+        while ((mask >> shift) >= (1u << 16)) shift++;
+
+        std::vector<Slot> pending(entries.size());
+        std::vector<uint32_t> offsets((mask >> shift) + 2, 0);
+        for (size_t id = 0; id < entries.size(); ++id) {
+            pending[id] = Slot{hashName(view(entries[id])), (FileID)id};
+            offsets[((pending[id].hash & mask) >> shift) + 1]++;
+        }
+        for (size_t b = 1; b < offsets.size(); ++b) offsets[b] += offsets[b - 1];
+        std::vector<Slot> ordered(pending.size());
+        for (const Slot& slot : pending) ordered[offsets[(slot.hash & mask) >> shift]++] = slot;
+
+        for (const Slot& slot : ordered) {
+            size_t i = findSlot(view(entries[slot.id]), slot.hash);
+            if (table[i].id != EMPTY_SLOT) continue; // Duplicate line, keep the first
+            table[i] = slot;
+            used_slots++;
+            entries[slot.id].live = true;
+            live_count++;
+        }
+
+        dead_bytes = start;
+        for (size_t id = entries.size(); id-- > 0; ) {
+            if (entries[id].live) continue;
+            dead_bytes += entries[id].length;
+            entries[id] = Entry{0, 0, false};
+            free_ids.push_back((FileID)id);
+        }
+    }
+
+    // Pre-size for 'count' files totalling roughly 'name_bytes' characters
+    void reserve(size_t count, size_t name_bytes = 0) {
+        entries.reserve(count);
+        arena.reserve(name_bytes);
+        if ((count + 1) * 10 > table.size() * 7) rehash(count);
+    }
+
+    // Visit every live file in ID order: fn(FileID, std::string_view)
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t id = 0; id < entries.size(); ++id) {
+            if (entries[id].live) fn((FileID)id, view(entries[id]));
+        }
+    }
+
+    // Approximate heap footprint
+    size_t memoryUsage() const {
+        return arena.capacity() + entries.capacity() * sizeof(Entry) + free_ids.capacity() * sizeof(FileID) + table.capacity() * sizeof(Slot);
+    }
+};
+
+#endif
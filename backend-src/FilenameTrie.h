@@ -7,13 +7,15 @@
 #include <iostream>
 #include <algorithm>
 
+#include "FileRegistry.h"
+
 class TrieNode {
 public:
     std::unordered_map<char, TrieNode*> children;
-    std::string file_id; 
+    FileID file_id; 
     bool is_end_of_file;
 
-    TrieNode() : is_end_of_file(false) {}
+    TrieNode() : file_id(INVALID_FILE_ID), is_end_of_file(false) {}
     
     ~TrieNode() {
         for (auto& pair : children) {
@@ -25,6 +27,7 @@ public:
 class FilenameTrie {
 private:
     TrieNode* root;
+    size_t node_count = 1;
 
     // --- HELPER 1: For Deletion ---
     bool removeHelper(TrieNode* current, const std::string& filename, int depth) {
@@ -33,7 +36,7 @@ private:
         if (depth == filename.size()) {
             if (!current->is_end_of_file) return false;
             current->is_end_of_file = false;
-            current->file_id = "";
+            current->file_id = INVALID_FILE_ID;
             return current->children.empty();
         }
 
@@ -45,13 +48,14 @@ private:
         if (shouldDeleteChild) {
             delete current->children[ch];
             current->children.erase(ch);
+            node_count--;
             return !current->is_end_of_file && current->children.empty();
         }
         return false;
     }
 
     // --- HELPER 2: For Listing/Prefix Search ---
-    void collectAll(TrieNode* node, std::vector<std::string>& results) {
+    void collectAll(TrieNode* node, std::vector<FileID>& results) {
         if (node->is_end_of_file) {
             results.push_back(node->file_id);
         }
@@ -64,11 +68,12 @@ public:
     FilenameTrie() { root = new TrieNode(); }
     ~FilenameTrie() { delete root; }
 
-    void insert(const std::string& filename, const std::string& id) {
+    void insert(const std::string& filename, FileID id) {
         TrieNode* current = root;
         for (char ch : filename) {
             if (current->children.find(ch) == current->children.end()) {
                 current->children[ch] = new TrieNode();
+                node_count++;
             }
             current = current->children[ch];
         }
@@ -76,18 +81,18 @@ public:
         current->file_id = id;
     }
 
-    std::string search(const std::string& filename) {
+    FileID search(const std::string& filename) {
         TrieNode* current = root;
         for (char ch : filename) {
-            if (current->children.find(ch) == current->children.end()) return "";
+            if (current->children.find(ch) == current->children.end()) return INVALID_FILE_ID;
             current = current->children[ch];
         }
-        return (current->is_end_of_file) ? current->file_id : "";
+        return (current->is_end_of_file) ? current->file_id : INVALID_FILE_ID;
     }
 
     // This is the function giving you trouble in main.cpp
-    std::vector<std::string> findWithPrefix(const std::string& prefix) {
-        std::vector<std::string> results;
+    std::vector<FileID> findWithPrefix(const std::string& prefix) {
+        std::vector<FileID> results;
         TrieNode* current = root;
         for (char ch : prefix) {
             if (current->children.find(ch) == current->children.end()) return results;
@@ -101,6 +106,12 @@ public:
     bool remove(const std::string& filename) {
         return removeHelper(root, filename, 0);
     }
+
+    // Approximate heap footprint: every node plus its slot in the parent's child map
+    size_t memoryUsage() const {
+        size_t per_node = sizeof(TrieNode) + sizeof(std::pair<const char, TrieNode*>) + 3 * sizeof(void*);
+        return node_count * per_node;
+    }
 };
 
 #endif
\ No newline at end of file
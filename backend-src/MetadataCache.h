@@ -1,7 +1,12 @@
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
 #include <unordered_map>
 #include <string>
 #include <chrono>
 
+#include "FileRegistry.h"
+
 struct FileMetadata {
     long long file_size = 0;
     int permissions = 0; 
@@ -9,17 +14,20 @@ struct FileMetadata {
     // Times are often stored as standard library high-resolution clock types
     std::chrono::system_clock::time_point creation_time;
     std::chrono::system_clock::time_point modification_time;
+    // The file's last_write_time when the engine last wrote or read it (0 = unknown);
+    // lets a change notification for the engine's own write be told apart
+    long long disk_stamp = 0;
     // Add other critical metadata as needed
 };
 
 class MetadataCache {
 private:
-    // Key: File Path/ID (string), Value: FileMetadata struct
-    std::unordered_map<std::string, FileMetadata> metadata_store;
+    // Key: interned File ID, Value: FileMetadata struct
+    std::unordered_map<FileID, FileMetadata> metadata_store;
 
 public:
     // Function to retrieve metadata
-    bool getMetadata(const std::string& file_id, FileMetadata& data) {
+    bool getMetadata(FileID file_id, FileMetadata& data) {
         // Use find() for efficiency, then check if the key exists
         auto it = metadata_store.find(file_id);
         if (it != metadata_store.end()) {
@@ -30,13 +38,21 @@ public:
     }
 
     // Function to update or insert metadata
-    void setMetadata(const std::string& file_id, const FileMetadata& data) {
+    void setMetadata(FileID file_id, const FileMetadata& data) {
         // Insert or overwrite the existing entry
         metadata_store[file_id] = data;
     }
 
     // Function to remove metadata when a file is deleted
-    void removeMetadata(const std::string& file_id) {
+    void removeMetadata(FileID file_id) {
         metadata_store.erase(file_id);
     }
-};
\ No newline at end of file
+
+    // Approximate heap footprint
+    size_t memoryUsage() const {
+        return metadata_store.bucket_count() * sizeof(void*)
+             + metadata_store.size() * (sizeof(std::pair<const FileID, FileMetadata>) + 2 * sizeof(void*));
+    }
+};
+
+#endif
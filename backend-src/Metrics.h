@@ -0,0 +1,235 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Engine instrumentation.
+// Each thread owns a shard of counters and only that thread ever writes it,
+// so an increment is a relaxed load + store (no lock, no atomic RMW).
+// Readers (STATS) sum every shard. Build with -DCMFS_DISABLE_METRICS and the
+// CMFS_COUNT / CMFS_TIME_COMMAND macros compile away to nothing.
+
+enum MetricCounter {
+    CACHE_HITS,
+    CACHE_MISSES,
+    CACHE_EVICTIONS,
+    CACHE_DEMOTIONS,
+    CACHE_COMPRESSED_HITS,
+    PREFETCH_ISSUED,
+    PREFETCH_USED,
+    PREFETCH_WASTED,
+    DISK_READ_OPS,
+    DISK_READ_BYTES,
+    DISK_WRITE_OPS,
+    DISK_WRITE_BYTES,
+    DEDUP_HITS,
+    COUNTER_COUNT
+};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "cache_hits", "cache_misses", "cache_evictions",
+    "cache_demotions", "cache_compressed_hits",
+    "prefetch_issued", "prefetch_used", "prefetch_wasted",
+    "disk_read_ops", "disk_read_bytes", "disk_write_ops", "disk_write_bytes",
+    "dedup_hits"
+};
+
+enum MetricCommand {
+    CMD_WRITE,
+    CMD_READ,
+    CMD_LIST,
+    CMD_DELETE,
+    CMD_TAG,
+    CMD_SEARCH_KEY,
+    CMD_SUGGEST_KEYS,
+    CMD_RENAME,
+    CMD_STATS,
+    CMD_ACCESS_PAIR,
+    CMD_PREFETCH,
+    COMMAND_COUNT
+};
+
+const char* const COMMAND_NAMES[COMMAND_COUNT] = {
+    "WRITE", "READ", "LIST", "DELETE", "TAG",
+    "SEARCH_KEY", "SUGGEST_KEYS", "RENAME", "STATS",
+    "ACCESS_PAIR", "PREFETCH"
+};
+
+// --- Latency Histogram ---
+// Log-linear buckets: 8 sub-buckets per power of two (~12.5% precision),
+// covering the full uint64 nanosecond range in 496 buckets.
+const int HIST_SUB_BITS = 3;
+const int HIST_SUB = 1 << HIST_SUB_BITS;
+const int HIST_BUCKETS = (64 - HIST_SUB_BITS + 1) * HIST_SUB;
+
+// Position of the highest set bit (v != 0)
+inline int highestBit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (int)index;
+#else
+    int msb = 0;
+    while (v >>= 1) msb++;
+    return msb;
+#endif
+}
+
+inline int histBucket(uint64_t v) {
+    if (v < (uint64_t)HIST_SUB) return (int)v;
+    int msb = highestBit(v);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+// Smallest value that falls in the bucket
+inline uint64_t histBucketLow(int idx) {
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int shift = idx / HIST_SUB - 1;
+    return (uint64_t)(HIST_SUB + idx % HIST_SUB) << shift;
+}
+
+struct MetricsShard {
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<uint64_t> latency[COMMAND_COUNT][HIST_BUCKETS];
+
+    MetricsShard() {
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+        for (auto& cmd : latency)
+            for (auto& b : cmd) b.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Single-writer increment: safe because only the owning thread writes its shard
+inline void shardAdd(std::atomic<uint64_t>& slot, uint64_t n) {
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+class Metrics {
+private:
+    // Shards are never freed, so a reader can walk them while threads come and go
+    static std::mutex& registryLock() { static std::mutex m; return m; }
+    static std::vector<std::unique_ptr<MetricsShard>>& shards() {
+        static std::vector<std::unique_ptr<MetricsShard>> s;
+        return s;
+    }
+
+    static MetricsShard* registerShard() {
+        std::lock_guard<std::mutex> guard(registryLock());
+        shards().emplace_back(new MetricsShard());
+        return shards().back().get();
+    }
+
+public:
+    static MetricsShard& local() {
+        thread_local MetricsShard* shard = registerShard();
+        return *shard;
+    }
+
+    static void count(MetricCounter c, uint64_t n = 1) {
+        shardAdd(local().counters[c], n);
+    }
+
+    static void recordLatency(MetricCommand cmd, uint64_t nanos) {
+        shardAdd(local().latency[cmd][histBucket(nanos)], 1);
+    }
+
+    // --- Readers (merge every shard) ---
+    static uint64_t total(MetricCounter c) {
+        std::lock_guard<std::mutex> guard(registryLock());
+        uint64_t sum = 0;
+        for (const auto& s : shards()) sum += s->counters[c].load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    static std::vector<uint64_t> histogram(MetricCommand cmd) {
+        std::lock_guard<std::mutex> guard(registryLock());
+        std::vector<uint64_t> merged(HIST_BUCKETS, 0);
+        for (const auto& s : shards())
+            for (int i = 0; i < HIST_BUCKETS; ++i)
+                merged[i] += s->latency[cmd][i].load(std::memory_order_relaxed);
+        return merged;
+    }
+
+    // Value at quantile q (0..1), reported as the bucket's lower bound
+    static uint64_t percentile(const std::vector<uint64_t>& hist, double q) {
+        uint64_t n = 0;
+        for (uint64_t c : hist) n += c;
+        if (n == 0) return 0;
+
+        uint64_t rank = (uint64_t)std::ceil(q * n);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < HIST_BUCKETS; ++i) {
+            seen += hist[i];
+            if (seen >= rank) return histBucketLow(i);
+        }
+        return histBucketLow(HIST_BUCKETS - 1);
+    }
+
+    // Counters + latency section of the STATS payload (no surrounding braces)
+    static std::string toJSON() {
+        std::string json = "\"counters\": {";
+        for (int c = 0; c < COUNTER_COUNT; ++c) {
+            json += "\"" + std::string(COUNTER_NAMES[c]) + "\": " + std::to_string(total((MetricCounter)c));
+            if (c < COUNTER_COUNT - 1) json += ",";
+        }
+        json += "}, \"latency_ns\": {";
+
+        bool first = true;
+        for (int cmd = 0; cmd < COMMAND_COUNT; ++cmd) {
+            std::vector<uint64_t> hist = histogram((MetricCommand)cmd);
+            uint64_t n = 0;
+            for (uint64_t c : hist) n += c;
+            if (n == 0) continue;
+
+            if (!first) json += ",";
+            first = false;
+            json += "\"" + std::string(COMMAND_NAMES[cmd]) + "\": {\"count\": " + std::to_string(n);
+            json += ", \"p50\": " + std::to_string(percentile(hist, 0.50));
+            json += ", \"p99\": " + std::to_string(percentile(hist, 0.99));
+            json += ", \"p999\": " + std::to_string(percentile(hist, 0.999)) + "}";
+        }
+        json += "}";
+        return json;
+    }
+};
+
+// Times the enclosing scope and files it under one command
+class ScopedLatency {
+private:
+    MetricCommand cmd;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedLatency(MetricCommand c) : cmd(c), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::recordLatency(cmd, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+#ifdef CMFS_DISABLE_METRICS
+#define CMFS_METRICS_ENABLED false
+#define CMFS_COUNT(counter, n) ((void)0)
+#define CMFS_TIME_COMMAND(cmd) ((void)0)
+#else
+#define CMFS_METRICS_ENABLED true
+#define CMFS_COUNT(counter, n) Metrics::count((counter), (n))
+#define CMFS_TIME_COMMAND(cmd) ScopedLatency cmfs_scoped_latency_(cmd)
+#endif
+
+#endif
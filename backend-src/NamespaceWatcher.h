@@ -0,0 +1,123 @@
+#ifndef NAMESPACEWATCHER_H
+#define NAMESPACEWATCHER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches the storage directory for changes made behind the engine's back.
+// A background thread reads inotify and queues the names that changed; the
+// engine drains the queue between commands and re-checks each name against
+// the directory. Checking pending() costs one atomic load and no syscall.
+// Without inotify (non-Linux) start() returns false and the engine falls
+// back to rescanning the directory.
+class NamespaceWatcher {
+private:
+    std::atomic<bool> stop{false};
+    std::atomic<bool> has_pending{false};
+    std::mutex queue_lock;
+    std::vector<std::string> changed;
+    bool overflowed = false; // Kernel dropped events: caller must rescan everything
+    std::thread worker;
+    int fd = -1;
+
+#ifdef __linux__
+    // Read whatever the kernel has queued (fd is non-blocking). False if nothing was there.
+    bool readEvents() {
+        alignas(struct inotify_event) char buffer[64 * 1024];
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len <= 0) return false;
+
+        std::lock_guard<std::mutex> guard(queue_lock);
+        for (char* p = buffer; p < buffer + len; ) {
+            struct inotify_event* event = reinterpret_cast<struct inotify_event*>(p);
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+            } else if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                changed.emplace_back(event->name);
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+        has_pending.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void run() {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        while (!stop.load(std::memory_order_relaxed)) {
+            // Wake up periodically so shutdown doesn't wait on a quiet directory
+            if (poll(&pfd, 1, 200) > 0) readEvents();
+        }
+    }
+#endif
+
+public:
+    NamespaceWatcher() = default;
+    NamespaceWatcher(const NamespaceWatcher&) = delete;
+    NamespaceWatcher& operator=(const NamespaceWatcher&) = delete;
+
+    ~NamespaceWatcher() {
+        shutdown();
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool start(const std::string& directory) {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+
+        uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF;
+        if (inotify_add_watch(fd, directory.c_str(), mask) < 0) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+
+        worker = std::thread(&NamespaceWatcher::run, this);
+        return true;
+#else
+        (void)directory;
+        return false;
+#endif
+    }
+
+    bool isActive() const { return fd >= 0; }
+
+    // Stop the background thread and queue every event the kernel still holds,
+    // so a following drain() sees all changes made up to this call.
+    void shutdown() {
+        stop.store(true);
+        if (worker.joinable()) worker.join();
+#ifdef __linux__
+        if (fd >= 0) {
+            while (readEvents()) {}
+        }
+#endif
+    }
+
+    bool pending() const { return has_pending.load(std::memory_order_acquire); }
+
+    // Hand over every queued name. Returns true if events were lost and the
+    // whole directory has to be rescanned instead.
+    bool drain(std::vector<std::string>& names) {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        names.swap(changed);
+        changed.clear();
+        bool lost = overflowed;
+        overflowed = false;
+        has_pending.store(false, std::memory_order_relaxed);
+        return lost;
+    }
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// The line protocol spoken between the Node bridge and the engine (and by the
+// shard router, which sits in between and speaks it on both sides).
+
+inline std::string buildJSONResponse(const std::string& status, const std::string& message, const std::string& extra = "") {
+    std::string json = "{";
+    json += "\"status\": \"" + status + "\",";
+    json += "\"message\": \"" + message + "\"";
+    if (!extra.empty()) {
+        json += "," + extra;
+    }
+    json += "}";
+    return json;
+}
+
+// Append 'value' to 'out' as the inside of a JSON string. Responses must stay
+// on one line (the router pairs them with requests line by line), so every
+// control character is escaped.
+inline void appendEscaped(std::string& out, std::string_view value) {
+    static const char HEX[] = "0123456789abcdef";
+    size_t run = 0; // Start of the stretch that needs no escaping
+    for (size_t i = 0; i < value.size(); ++i) {
+        unsigned char c = (unsigned char)value[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(value.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0xF];
+        }
+    }
+    out.append(value.data() + run, value.size() - run);
+}
+
+inline std::string escapeJSON(std::string_view value) {
+    std::string out;
+    out.reserve(value.size());
+    appendEscaped(out, value);
+    return out;
+}
+
+inline void appendUTF8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xC0 | (code >> 6));
+        out += (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += (char)(0xE0 | (code >> 12));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    } else {
+        out += (char)(0xF0 | (code >> 18));
+        out += (char)(0x80 | ((code >> 12) & 0x3F));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+// The 4 hex digits of a \u escape at line[pos] (-1 if malformed)
+inline long hexQuad(const std::string& line, size_t pos) {
+    if (pos + 4 > line.size()) return -1;
+    long code = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = line[i];
+        int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+        if (digit < 0) return -1;
+        code = code * 16 + digit;
+    }
+    return code;
+}
+
+// Decode the JSON string body starting at text[start] (just past its opening
+// quote) up to the closing quote. *end_out gets the position after that quote.
+inline std::string decodeJSONString(const std::string& text, size_t start, size_t* end_out = nullptr) {
+    std::string value;
+    size_t pos = start;
+    while (pos < text.size()) {
+        size_t stop = text.find_first_of("\"\\", pos);
+        if (stop == std::string::npos) stop = text.size();
+        value.append(text, pos, stop - pos);
+        pos = stop + 1;
+        if (stop >= text.size() || text[stop] == '"' || stop + 1 >= text.size()) break;
+
+        char escape = text[stop + 1];
+        pos = stop + 2;
+        switch (escape) {
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'u': {
+            long code = hexQuad(text, pos);
+            if (code < 0) break;
+            pos += 4;
+            // A surrogate pair spells one code point above U+FFFF
+            if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                long low = hexQuad(text, pos + 2);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+            }
+            appendUTF8(value, (uint32_t)code);
+            break;
+        }
+        default: value += escape; // \" \\ \/
+        }
+    }
+    if (end_out) *end_out = std::min(pos, text.size());
+    return value;
+}
+
+// Pull the string value of "key":"..." out of a protocol line ("" if absent).
+// JSON escapes are decoded, so content sent with JSON.stringify arrives intact.
+inline std::string extractField(const std::string& line, const std::string& key) {
+    std::string marker = "\"" + key + "\":\"";
+    size_t start = line.find(marker);
+    if (start == std::string::npos) return "";
+    return decodeJSONString(line, start + marker.size());
+}
+
+// File names and keys end up in manifests, journals and responses one per
+// line, unescaped: quotes, backslashes and control characters are refused.
+inline bool validName(const std::string& name) {
+    for (unsigned char c : name) {
+        if (c < 0x20 || c == '"' || c == '\\') return false;
+    }
+    return true;
+}
+
+enum ProtocolAction {
+    ACTION_WRITE,
+    ACTION_STATS,
+    ACTION_RENAME,
+    ACTION_ACCESS_PAIR,
+    ACTION_PREFETCH,
+    ACTION_READ,
+    ACTION_LIST,
+    ACTION_DELETE,
+    ACTION_TAG,
+    ACTION_SEARCH_KEY,
+    ACTION_SUGGEST_KEYS,
+    ACTION_UNKNOWN
+};
+
+// Which command a line is. A well-formed "action":"..." field decides; other
+// lines go through the checks (and their order) the engine has always used,
+// so loosely formatted lines keep working. (Those match anywhere in the line:
+// a READ of "WRITEUP.txt" must not become a WRITE.)
+inline ProtocolAction protocolAction(const std::string& line) {
+    static const std::pair<const char*, ProtocolAction> ACTIONS[] = {
+        {"WRITE", ACTION_WRITE}, {"STATS", ACTION_STATS}, {"RENAME", ACTION_RENAME},
+        {"ACCESS_PAIR", ACTION_ACCESS_PAIR}, {"PREFETCH", ACTION_PREFETCH}, {"READ", ACTION_READ},
+        {"LIST", ACTION_LIST}, {"DELETE", ACTION_DELETE}, {"TAG", ACTION_TAG},
+        {"SEARCH_KEY", ACTION_SEARCH_KEY}, {"SUGGEST_KEYS", ACTION_SUGGEST_KEYS}
+    };
+    if (line.find("\"action\":\"") != std::string::npos) {
+        std::string name = extractField(line, "action");
+        for (const auto& action : ACTIONS) {
+            if (name == action.first) return action.second;
+        }
+    }
+
+    if (line.find("WRITE") != std::string::npos) return ACTION_WRITE;
+    if (line.find("\"action\":\"STATS\"") != std::string::npos) return ACTION_STATS;
+    if (line.find("\"action\":\"RENAME\"") != std::string::npos) return ACTION_RENAME;
+    if (line.find("\"action\":\"ACCESS_PAIR\"") != std::string::npos) return ACTION_ACCESS_PAIR;
+    if (line.find("\"action\":\"PREFETCH\"") != std::string::npos) return ACTION_PREFETCH;
+    if (line.find("READ") != std::string::npos) return ACTION_READ;
+    if (line.find("LIST") != std::string::npos) return ACTION_LIST;
+    if (line.find("\"action\":\"DELETE\"") != std::string::npos) return ACTION_DELETE;
+    if (line.find("\"action\":\"TAG\"") != std::string::npos) return ACTION_TAG;
+    if (line.find("\"action\":\"SEARCH_KEY\"") != std::string::npos) return ACTION_SEARCH_KEY;
+    if (line.find("SUGGEST_KEYS") != std::string::npos) return ACTION_SUGGEST_KEYS;
+    return ACTION_UNKNOWN;
+}
+
+// Every line gets exactly one response line, except these which are ignored
+inline bool expectsResponse(ProtocolAction action, const std::string& line) {
+    if (action == ACTION_DELETE) return line.find("\"file\":\"") != std::string::npos;
+    if (action == ACTION_SUGGEST_KEYS) return line.find("\"prefix\":\"") != std::string::npos;
+    return true;
+}
+
+inline std::string unknownCommandResponse(const std::string& line) {
+    return "{\"status\":\"error\",\"message\":\"Unknown command received: " + escapeJSON(line) + "\"}";
+}
+
+#endif
@@ -0,0 +1,913 @@
+#ifndef SHARDROUTER_H
+#define SHARDROUTER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Protocol.h"
+#include "FileRegistry.h"
+#include "DependencyGraph.h"
+
+// Stable 64-bit hash for placement. std::hash may change between builds,
+// and a file's shard must not.
+inline uint64_t placementHash(std::string_view key) {
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33; // FNV's low bits are weak; finish with a mixer
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Consistent-hash ring. Each shard owns VNODES points; a file belongs to the
+// shard of the first point at or after its hash. Going from N to N+1 shards
+// only moves the ~1/(N+1) of files that now land on the new shard's points.
+class ShardRing {
+private:
+    struct Point {
+        uint64_t hash;
+        int shard;
+        bool operator<(const Point& other) const { return hash < other.hash; }
+    };
+    std::vector<Point> points;
+
+public:
+    static const int VNODES = 64;
+
+    explicit ShardRing(int shards) {
+        for (int s = 0; s < shards; ++s) {
+            for (int v = 0; v < VNODES; ++v) {
+                points.push_back(Point{placementHash("shard-" + std::to_string(s) + "/" + std::to_string(v)), s});
+            }
+        }
+        std::sort(points.begin(), points.end());
+    }
+
+    int owner(std::string_view filename) const {
+        Point key{placementHash(filename), 0};
+        auto it = std::lower_bound(points.begin(), points.end(), key);
+        return it == points.end() ? points.front().shard : it->shard;
+    }
+};
+
+// Find the [...] value of "key": in a response and return what is inside the
+// brackets ("" if absent). Brackets inside quoted strings are skipped.
+inline std::string arrayField(const std::string& response, const std::string& key, size_t* end_out = nullptr) {
+    std::string marker = "\"" + key + "\": [";
+    size_t start = response.find(marker);
+    if (start == std::string::npos) return "";
+    start += marker.size();
+
+    int depth = 1;
+    bool quoted = false;
+    for (size_t i = start; i < response.size(); ++i) {
+        char c = response[i];
+        if (quoted && c == '\\') {
+            i++; // Escaped character
+            continue;
+        }
+        if (c == '"') quoted = !quoted;
+        if (quoted) continue;
+        if (c == '[') depth++;
+        if (c == ']' && --depth == 0) {
+            if (end_out) *end_out = i + 1;
+            return response.substr(start, i - start);
+        }
+    }
+    return "";
+}
+
+// The text of the string field "key": "..." in a response, still JSON-escaped
+// (so it can go straight into another protocol line). False if absent.
+inline bool rawStringField(const std::string& response, const std::string& key, std::string& value) {
+    std::string marker = "\"" + key + "\": \"";
+    size_t start = response.find(marker);
+    if (start == std::string::npos) return false;
+    start += marker.size();
+    for (size_t i = start; i < response.size(); ++i) {
+        if (response[i] == '\\') {
+            i++;
+        } else if (response[i] == '"') {
+            value = response.substr(start, i - start);
+            return true;
+        }
+    }
+    return false;
+}
+
+// The strings of a flat JSON array body, decoded. The router keeps names
+// decoded and escapes them again wherever it writes them out.
+inline std::vector<std::string> splitStrings(const std::string& body) {
+    std::vector<std::string> values;
+    size_t pos = 0;
+    while ((pos = body.find('"', pos)) != std::string::npos) {
+        values.push_back(decodeJSONString(body, pos + 1, &pos));
+    }
+    return values;
+}
+
+// A JSON string literal
+inline std::string jsonString(std::string_view value) {
+    return "\"" + escapeJSON(value) + "\"";
+}
+
+// Every engine response is one JSON object starting with its status
+inline bool isResponse(const std::string& line) {
+    return line.compare(0, 10, "{\"status\":") == 0 && line.back() == '}';
+}
+
+inline bool isSuccess(const std::string& response) {
+    return response.find("\"status\": \"success\"") != std::string::npos;
+}
+
+// --- The Shard Router ---
+// Spawns N engine processes, each with its own storage directory, and speaks
+// the engine's line protocol on stdin/stdout, so the Node bridge can run it in
+// place of a single engine.
+// Single-file commands go to the file's owner. LIST, SEARCH_KEY, SUGGEST_KEYS
+// and STATS are sent to every shard and merged. An ACCESS_PAIR whose files
+// live on different shards is learned here, and READ merges those edges into
+// the owner's predictions (and asks the other shard to prefetch).
+// Requests are pipelined: many can be in flight on every shard at once, and
+// responses still come out in request order.
+class ShardRouter {
+private:
+    struct Request {
+        ProtocolAction action = ACTION_UNKNOWN;
+        std::string line;
+        std::vector<std::string> parts; // One response per shard contacted
+        size_t remaining = 0;
+        bool deferred = false;          // Runs on its own once everything before it is done
+        std::string response;           // Set when the router answers by itself
+    };
+
+    // A line sent to a shard whose response is still due. request == nullptr: discard it.
+    struct Slot {
+        Request* request;
+        size_t part;
+    };
+
+    struct ShardProcess {
+        pid_t pid = -1;
+        int to_child = -1;
+        int from_child = -1;
+        std::string outbox; // Written but not yet taken by the pipe
+        std::string inbox;  // Partial response line
+        std::deque<Slot> waiting;
+        bool alive = false;
+    };
+
+    static const size_t MAX_IN_FLIGHT = 4096;
+    static const int PREDICTION_LIMIT = 3; // Same as the engine
+
+    // A cross-shard RENAME writes its copy under this prefix first (see
+    // moveRenamed). Clients can't create such names, so a leftover one is
+    // always the router's own and safe to delete.
+    static constexpr const char* SCRATCH_PREFIX = ".cmfs-move~";
+
+    static bool isScratchName(const std::string& name) {
+        return name.compare(0, std::strlen(SCRATCH_PREFIX), SCRATCH_PREFIX) == 0;
+    }
+
+    std::string engine_path;
+    std::string base_path;
+    int shard_count;
+    ShardRing ring;
+    std::vector<ShardProcess> shards;
+
+    std::deque<std::unique_ptr<Request>> queue; // Client requests, in arrival order
+    std::string input;
+    bool input_closed = false;
+    std::string output;
+    std::ofstream trace;
+
+    // Edges between files on different shards
+    FileRegistry cross_names;
+    DependencyGraph cross_graph;
+
+    uint64_t requests_routed = 0;
+    uint64_t scatter_gathers = 0;
+    uint64_t cross_pairs = 0;
+    uint64_t files_moved = 0;
+
+    std::string shardStorage(int shard) const {
+        return base_path + "shard-" + std::to_string(shard) + "/";
+    }
+
+    std::string countPath() const { return base_path + "SHARDS"; }
+
+    // --- Shard processes ---
+    bool spawn(int shard) {
+        int to_child[2], from_child[2];
+        if (pipe(to_child) < 0) return false;
+        if (pipe(from_child) < 0) {
+            close(to_child[0]);
+            close(to_child[1]);
+            return false;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            dup2(to_child[0], STDIN_FILENO);
+            dup2(from_child[1], STDOUT_FILENO);
+            close(to_child[0]); close(to_child[1]);
+            close(from_child[0]); close(from_child[1]);
+            setenv("CMFS_STORAGE", shardStorage(shard).c_str(), 1);
+            unsetenv("CMFS_TRACE_FILE"); // The router records the trace once
+            unsetenv("CMFS_ENGINE");
+            execl(engine_path.c_str(), engine_path.c_str(), (char*)nullptr);
+            std::perror("[Router] exec");
+            _exit(127);
+        }
+
+        close(to_child[0]);
+        close(from_child[1]);
+        ShardProcess& process = shards[shard];
+        process.pid = pid;
+        process.to_child = to_child[1];
+        process.from_child = from_child[0];
+        process.alive = true;
+        fcntl(process.to_child, F_SETFL, O_NONBLOCK);
+        fcntl(process.from_child, F_SETFL, O_NONBLOCK);
+        fcntl(process.to_child, F_SETFD, FD_CLOEXEC);
+        fcntl(process.from_child, F_SETFD, FD_CLOEXEC);
+        return true;
+    }
+
+    // Close the shard's stdin and wait: the engine saves its manifest on the way out
+    void stop(int shard) {
+        ShardProcess& process = shards[shard];
+        if (process.to_child >= 0) close(process.to_child);
+        if (process.pid > 0) waitpid(process.pid, nullptr, 0);
+        if (process.from_child >= 0) close(process.from_child);
+        process = ShardProcess();
+    }
+
+    void complete(const Slot& slot, const std::string& line) {
+        if (!slot.request) return;
+        slot.request->parts[slot.part] = line;
+        slot.request->remaining--;
+    }
+
+    void shardDied(int shard) {
+        ShardProcess& process = shards[shard];
+        if (!process.alive) return;
+        std::cerr << "[Router] Shard " << shard << " exited" << std::endl;
+        process.alive = false;
+        std::string error = buildJSONResponse("error", "Shard " + std::to_string(shard) + " unavailable");
+        for (const Slot& slot : process.waiting) complete(slot, error);
+        process.waiting.clear();
+        process.outbox.clear();
+    }
+
+    void flushOutbox(int shard) {
+        ShardProcess& process = shards[shard];
+        while (process.alive && !process.outbox.empty()) {
+            ssize_t n = write(process.to_child, process.outbox.data(), process.outbox.size());
+            if (n > 0) {
+                process.outbox.erase(0, n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) shardDied(shard);
+                return;
+            }
+        }
+    }
+
+    void readShard(int shard) {
+        ShardProcess& process = shards[shard];
+        char buffer[64 * 1024];
+        ssize_t n = read(process.from_child, buffer, sizeof(buffer));
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+        if (n <= 0) {
+            shardDied(shard);
+            return;
+        }
+
+        process.inbox.append(buffer, n);
+        size_t start = 0, eol;
+        while ((eol = process.inbox.find('\n', start)) != std::string::npos) {
+            if (eol > start) {
+                std::string line = process.inbox.substr(start, eol - start);
+                if (process.waiting.empty() || !isResponse(line)) {
+                    shardDesynced(shard);
+                    return;
+                }
+                complete(process.waiting.front(), line);
+                process.waiting.pop_front();
+            }
+            start = eol + 1;
+        }
+        process.inbox.erase(0, start);
+    }
+
+    // Responses are matched to requests by position, so a stray line (or one
+    // more than was asked for) would hand every later answer to the wrong
+    // request. Fail what is outstanding and start the shard over instead.
+    void shardDesynced(int shard) {
+        std::cerr << "[Router] Shard " << shard << " sent an unexpected line; restarting it" << std::endl;
+        ShardProcess& process = shards[shard];
+        std::string error = buildJSONResponse("error", "Shard " + std::to_string(shard) + " out of sync");
+        for (const Slot& slot : process.waiting) complete(slot, error);
+        process.waiting.clear();
+
+        // With both pipes closed the engine sees EOF (or EPIPE) and exits
+        close(process.to_child);
+        close(process.from_child);
+        waitpid(process.pid, nullptr, 0);
+        process = ShardProcess();
+        if (!spawn(shard)) std::cerr << "[Router] Cannot restart shard " << shard << std::endl;
+    }
+
+    void send(int shard, const std::string& line, Request* request, size_t part) {
+        ShardProcess& process = shards[shard];
+        if (!process.alive) {
+            complete(Slot{request, part}, buildJSONResponse("error", "Shard " + std::to_string(shard) + " unavailable"));
+            return;
+        }
+        process.outbox += line;
+        process.outbox += '\n';
+        process.waiting.push_back(Slot{request, part});
+        flushOutbox(shard);
+    }
+
+    // One round of I/O: wait until something can move, then move it
+    void pump(bool accept_input) {
+        writeOutput();
+
+        std::vector<struct pollfd> fds;
+        std::vector<int> owners; // Shard per entry, -1 for stdin
+        bool want_input = accept_input && !input_closed && queue.size() < MAX_IN_FLIGHT;
+        if (want_input) {
+            fds.push_back({STDIN_FILENO, POLLIN, 0});
+            owners.push_back(-1);
+        }
+        for (size_t s = 0; s < shards.size(); ++s) {
+            const ShardProcess& process = shards[s];
+            if (!process.alive) continue;
+            short events = POLLIN;
+            fds.push_back({process.from_child, events, 0});
+            owners.push_back((int)s);
+            if (!process.outbox.empty()) {
+                fds.push_back({process.to_child, POLLOUT, 0});
+                owners.push_back((int)s);
+            }
+        }
+        if (fds.empty()) return;
+
+        if (poll(fds.data(), fds.size(), -1) < 0) return;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            if (owners[i] < 0) {
+                readInput();
+            } else if (fds[i].fd == shards[owners[i]].from_child) {
+                readShard(owners[i]);
+            } else {
+                flushOutbox(owners[i]);
+            }
+        }
+    }
+
+    // Send a batch of lines and wait for all of their responses
+    std::vector<std::string> callAll(const std::vector<std::pair<int, std::string>>& calls) {
+        std::vector<std::unique_ptr<Request>> pending;
+        for (const auto& call : calls) {
+            pending.emplace_back(new Request());
+            pending.back()->parts.resize(1);
+            pending.back()->remaining = 1;
+            send(call.first, call.second, pending.back().get(), 0);
+        }
+        for (const auto& request : pending) {
+            while (request->remaining > 0) pump(false);
+        }
+
+        std::vector<std::string> responses;
+        for (const auto& request : pending) responses.push_back(request->parts[0]);
+        return responses;
+    }
+
+    std::string call(int shard, const std::string& line) {
+        return callAll({{shard, line}})[0];
+    }
+
+    // --- Client side ---
+    void readInput() {
+        char buffer[64 * 1024];
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) return;
+        if (n <= 0) {
+            input_closed = true;
+            if (!input.empty()) input += '\n'; // Last line without a newline
+        } else {
+            input.append(buffer, n);
+        }
+        acceptLines();
+    }
+
+    void acceptLines() {
+        size_t start = 0, eol;
+        while (queue.size() < MAX_IN_FLIGHT && !blocked() && (eol = input.find('\n', start)) != std::string::npos) {
+            accept(input.substr(start, eol - start));
+            start = eol + 1;
+        }
+        input.erase(0, start);
+    }
+
+    // A deferred request holds back everything after it
+    bool blocked() const {
+        return !queue.empty() && queue.back()->deferred;
+    }
+
+    void accept(std::string line) {
+        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+        if (line.empty()) return;
+        if (trace.is_open()) trace << line << '\n';
+
+        ProtocolAction action = protocolAction(line);
+        if (!expectsResponse(action, line)) return;
+
+        std::unique_ptr<Request> request(new Request());
+        request->action = action;
+        request->line = line;
+        Request* r = request.get();
+        queue.push_back(std::move(request));
+        requests_routed++;
+
+        switch (action) {
+        case ACTION_LIST:
+        case ACTION_SEARCH_KEY:
+        case ACTION_SUGGEST_KEYS:
+        case ACTION_STATS:
+            scatter_gathers++;
+            r->parts.resize(shard_count);
+            r->remaining = shard_count;
+            for (int s = 0; s < shard_count; ++s) send(s, line, r, s);
+            break;
+        case ACTION_ACCESS_PAIR: {
+            std::string source = extractField(line, "source");
+            std::string target = extractField(line, "target");
+            int source_shard = ring.owner(source), target_shard = ring.owner(target);
+            if (source_shard == target_shard) {
+                forward(r, source_shard);
+            } else {
+                // Learned here; first make sure both files exist (PREFETCH doubles as the check)
+                cross_pairs++;
+                r->parts.resize(2);
+                r->remaining = 2;
+                send(source_shard, prefetchLine(source), r, 0);
+                send(target_shard, prefetchLine(target), r, 1);
+            }
+            break;
+        }
+        case ACTION_WRITE:
+            if (isScratchName(extractField(line, "file"))) {
+                r->response = buildJSONResponse("error", "Invalid file name");
+            } else {
+                forward(r, ring.owner(extractField(line, "file")));
+            }
+            break;
+        case ACTION_RENAME: {
+            std::string filename = extractField(line, "file");
+            std::string new_name = extractField(line, "to");
+            if (isScratchName(new_name)) {
+                r->response = buildJSONResponse("error", "Invalid file name");
+            } else if (ring.owner(filename) == ring.owner(new_name)) {
+                forward(r, ring.owner(filename));
+            } else {
+                r->deferred = true; // Moves the file between shards, see moveRenamed()
+                r->remaining = 1;
+            }
+            break;
+        }
+        case ACTION_UNKNOWN:
+            r->response = unknownCommandResponse(line);
+            break;
+        default: // READ, DELETE, TAG, PREFETCH
+            forward(r, ring.owner(extractField(line, "file")));
+        }
+    }
+
+    void forward(Request* request, int shard) {
+        request->parts.resize(1);
+        request->remaining = 1;
+        send(shard, request->line, request, 0);
+    }
+
+    static std::string prefetchLine(const std::string& filename) {
+        return "{\"action\":\"PREFETCH\",\"file\":" + jsonString(filename) + "}";
+    }
+
+    // --- Merging ---
+    std::string mergeArrays(const Request& request, const std::string& key) {
+        std::string merged;
+        for (const std::string& part : request.parts) {
+            std::string body = arrayField(part, key);
+            if (body.empty()) continue;
+            if (!merged.empty()) merged += ",";
+            merged += body;
+        }
+        return merged;
+    }
+
+    std::string finish(Request& request) {
+        // A shard that failed would silently leave its share of the namespace
+        // out of the answer: pass its error on instead
+        if (request.action == ACTION_LIST || request.action == ACTION_SEARCH_KEY || request.action == ACTION_SUGGEST_KEYS) {
+            for (const std::string& part : request.parts) {
+                if (!isSuccess(part)) return part;
+            }
+        }
+
+        switch (request.action) {
+        case ACTION_LIST:
+            return buildJSONResponse("success", "Directory listed", "\"files\": [" + mergeArrays(request, "files") + "]");
+        case ACTION_SEARCH_KEY: {
+            std::string files = mergeArrays(request, "files");
+            if (files.empty()) return buildJSONResponse("success", "No files found for this key", "\"files\": []");
+            return buildJSONResponse("success", "Search complete", "\"files\": [" + files + "]");
+        }
+        case ACTION_SUGGEST_KEYS: {
+            // Each shard's list is sorted; merge into one sorted, de-duplicated list
+            std::vector<std::string> keys;
+            for (const std::string& part : request.parts) {
+                std::vector<std::string> shard_keys = splitStrings(arrayField(part, "suggestions"));
+                keys.insert(keys.end(), shard_keys.begin(), shard_keys.end());
+            }
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            std::string json = "[";
+            for (size_t i = 0; i < keys.size(); ++i) {
+                json += jsonString(keys[i]);
+                if (i < keys.size() - 1) json += ",";
+            }
+            return buildJSONResponse("success", "Suggestions fetched", "\"suggestions\": " + json + "]");
+        }
+        case ACTION_STATS:
+            return buildJSONResponse("success", "Stats collected", "\"router\": " + statsJSON() + ", \"shards\": [" + joinParts(request) + "]");
+        case ACTION_ACCESS_PAIR:
+            if (request.parts.size() == 2) {
+                if (!isSuccess(request.parts[0]) || !isSuccess(request.parts[1])) {
+                    return buildJSONResponse("error", "File not found");
+                }
+                cross_graph.updateConnection(cross_names.intern(extractField(request.line, "source")),
+                                             cross_names.intern(extractField(request.line, "target")));
+                return buildJSONResponse("success", "Relationship learned");
+            }
+            return request.parts[0];
+        case ACTION_READ:
+            return mergePredictions(extractField(request.line, "file"), request.parts[0]);
+        case ACTION_DELETE:
+            if (isSuccess(request.parts[0])) forgetCross(extractField(request.line, "file"));
+            return request.parts[0];
+        case ACTION_RENAME:
+            if (isSuccess(request.parts[0])) renameCross(extractField(request.line, "file"), extractField(request.line, "to"));
+            return request.parts[0];
+        default:
+            return request.parts[0];
+        }
+    }
+
+    static std::string joinParts(const Request& request) {
+        std::string json;
+        for (size_t i = 0; i < request.parts.size(); ++i) {
+            json += request.parts[i];
+            if (i < request.parts.size() - 1) json += ",";
+        }
+        return json;
+    }
+
+    // Fold cross-shard edges into the owner's top predictions. The union of
+    // the two top lists contains the overall top, since every edge lives in
+    // exactly one of the two graphs.
+    std::string mergePredictions(const std::string& filename, const std::string& response) {
+        FileID id = cross_names.lookup(filename);
+        if (id == INVALID_FILE_ID || !isSuccess(response)) return response;
+        std::vector<Dependency> remote = cross_graph.getTopDependencies(id, PREDICTION_LIMIT);
+        if (remote.empty()) return response;
+
+        size_t cut = response.find("\"predictions\": [");
+        if (cut == std::string::npos) return response;
+        std::vector<std::string> names = splitStrings(arrayField(response, "predictions"));
+        std::string weights = arrayField(response, "prediction_weights");
+
+        std::vector<std::pair<std::string, int>> merged;
+        size_t pos = 0;
+        for (const std::string& name : names) {
+            int weight = std::atoi(weights.c_str() + std::min(pos, weights.size()));
+            pos = weights.find(',', pos);
+            pos = pos == std::string::npos ? weights.size() : pos + 1;
+            merged.emplace_back(name, weight);
+        }
+        for (const Dependency& dep : remote) merged.emplace_back(std::string(cross_names.name(dep.file_id)), dep.weight);
+        std::stable_sort(merged.begin(), merged.end(), [](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b) {
+            return a.second > b.second;
+        });
+        if (merged.size() > (size_t)PREDICTION_LIMIT) merged.resize(PREDICTION_LIMIT);
+
+        std::string prediction_json = "[", weight_json = "[";
+        int home = ring.owner(filename);
+        for (size_t i = 0; i < merged.size(); ++i) {
+            prediction_json += jsonString(merged[i].first);
+            weight_json += std::to_string(merged[i].second);
+            if (i < merged.size() - 1) {
+                prediction_json += ",";
+                weight_json += ",";
+            }
+            // The owner already prefetched its own predictions; warm the others on their shard
+            int shard = ring.owner(merged[i].first);
+            if (shard != home) send(shard, prefetchLine(merged[i].first), nullptr, 0);
+        }
+        return response.substr(0, cut) + "\"predictions\": " + prediction_json + "], \"prediction_weights\": " + weight_json + "]}";
+    }
+
+    void forgetCross(const std::string& filename) {
+        FileID id = cross_names.lookup(filename);
+        if (id == INVALID_FILE_ID) return;
+        cross_graph.removeFile(id);
+        cross_names.tombstone(id);
+    }
+
+    // Same as the engine: edges follow a renamed file, and a file renamed over is forgotten
+    void renameCross(const std::string& filename, const std::string& new_name) {
+        if (filename == new_name) return;
+        forgetCross(new_name);
+        FileID id = cross_names.lookup(filename);
+        if (id != INVALID_FILE_ID) cross_names.rename(id, new_name);
+    }
+
+    // The content of a successful READ response, as escaped by the engine
+    static bool contentOf(const std::string& read_response, std::string& content) {
+        return isSuccess(read_response) && rawStringField(read_response, "content", content);
+    }
+
+    // 'content' is already escaped (see contentOf)
+    static std::string writeLine(const std::string& filename, const std::string& content) {
+        return "{\"action\":\"WRITE\",\"file\":" + jsonString(filename) + ",\"data\":\"" + content + "\"}";
+    }
+
+    static std::string readLine(const std::string& filename) {
+        return "{\"action\":\"READ\",\"file\":" + jsonString(filename) + "}";
+    }
+
+    // A copy counts only once it reads back byte for byte
+    static bool sameContent(const std::string& read_response, const std::string& content) {
+        std::string copied;
+        return contentOf(read_response, copied) && copied == content;
+    }
+
+    static std::string deleteLine(const std::string& filename) {
+        return "{\"action\":\"DELETE\",\"file\":" + jsonString(filename) + "}";
+    }
+
+    // RENAME across shards: copy the file (with its tags) to a scratch name on
+    // the new owner, rename that over the target there, then delete the
+    // original. Until the copy is complete and verified neither the original
+    // nor an existing target is touched. Runs only once every earlier request
+    // has completed. Dependencies the old shard learned for the file do not
+    // move with it.
+    std::string moveRenamed(const Request& request) {
+        std::string filename = extractField(request.line, "file");
+        std::string new_name = extractField(request.line, "to");
+        int from = ring.owner(filename), to = ring.owner(new_name);
+        // The engine would refuse it too, but only after the copy was made
+        if (!validName(new_name)) return buildJSONResponse("error", "Invalid file name");
+
+        // One READ brings the content and the tags
+        std::string read = call(from, readLine(filename));
+        std::string content;
+        if (!contentOf(read, content)) {
+            return read.find("File not found") != std::string::npos ? read : buildJSONResponse("error", "Failed to rename file");
+        }
+        std::vector<std::string> tags = splitStrings(arrayField(read, "tags"));
+
+        std::string scratch = SCRATCH_PREFIX + new_name;
+        call(to, deleteLine(scratch)); // Left over from an interrupted move (clients can't own this name)
+        std::vector<std::pair<int, std::string>> tagging;
+        for (const std::string& tag : tags) {
+            tagging.emplace_back(to, "{\"action\":\"TAG\",\"file\":" + jsonString(scratch) + ",\"key\":" + jsonString(tag) + "}");
+        }
+        bool copied = isSuccess(call(to, writeLine(scratch, content))) && sameContent(call(to, readLine(scratch)), content);
+        if (copied) {
+            for (const std::string& tagged : callAll(tagging)) copied = copied && isSuccess(tagged);
+        }
+        // The engine's RENAME replaces an existing target in one step
+        if (!copied || !isSuccess(call(to, "{\"action\":\"RENAME\",\"file\":" + jsonString(scratch) + ",\"to\":" + jsonString(new_name) + "}"))) {
+            call(to, deleteLine(scratch));
+            return buildJSONResponse("error", "Failed to rename file");
+        }
+        call(from, deleteLine(filename));
+
+        renameCross(filename, new_name);
+        return buildJSONResponse("success", "File renamed", "\"file\": " + jsonString(new_name));
+    }
+
+    // Hand every finished request at the head of the queue to the client
+    void emitReady() {
+        do {
+            while (!queue.empty()) {
+                Request& head = *queue.front();
+                if (head.deferred) {
+                    head.response = moveRenamed(head);
+                    head.deferred = false;
+                    head.remaining = 0;
+                }
+                if (head.remaining > 0) break;
+                output += head.response.empty() ? finish(head) : head.response;
+                output += '\n';
+                queue.pop_front();
+            }
+            acceptLines(); // Lines held back by a deferred request or a full queue
+            // A newly accepted head may need no shard I/O at all (a deferred
+            // RENAME, an unknown command); nothing would wake us up for it
+        } while (!queue.empty() && (queue.front()->deferred || queue.front()->remaining == 0));
+    }
+
+    void writeOutput() {
+        size_t done = 0;
+        while (done < output.size()) {
+            ssize_t n = write(STDOUT_FILENO, output.data() + done, output.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += n;
+        }
+        output.clear();
+    }
+
+    // --- Rebalancing ---
+    // Shard count the store was last run with (0 for a new store)
+    int previousCount() const {
+        std::ifstream infile(countPath());
+        int count = 0;
+        std::string magic;
+        if (infile >> magic >> count && magic == "CMFS-SHARDS" && count > 0) return count;
+
+        // No record: count the shard directories
+        std::error_code ec;
+        while (std::filesystem::exists(shardStorage(count), ec)) count++;
+        return count;
+    }
+
+    // Move every file whose owner changed. Consistent hashing keeps that to
+    // the files on the gained/lost ring points. Copy, read the copy back, and
+    // only then delete the original, so an interrupted move only leaves
+    // duplicates and is simply rerun on the next start (the shard count is
+    // recorded last). False if any file could not be moved.
+    bool rebalance(int old_count) {
+        const size_t BATCH = 1024;
+        bool complete = true;
+        for (int s = 0; s < old_count; ++s) {
+            std::string listing = call(s, "{\"action\":\"LIST\"}");
+            std::vector<std::string> moving;
+            std::string body = arrayField(listing, "files");
+            const std::string marker = "{\"name\":\"";
+            for (size_t pos = body.find(marker); pos != std::string::npos; pos = body.find(marker, pos)) {
+                std::string name = decodeJSONString(body, pos + marker.size(), &pos);
+                if (ring.owner(name) != s) moving.push_back(name);
+            }
+
+            for (size_t begin = 0; begin < moving.size(); begin += BATCH) {
+                size_t end = std::min(moving.size(), begin + BATCH);
+                std::vector<std::pair<int, std::string>> reads, writes, checks, deletes;
+                for (size_t i = begin; i < end; ++i) reads.emplace_back(s, readLine(moving[i]));
+                std::vector<std::string> responses = callAll(reads);
+
+                std::vector<size_t> copied; // Index into 'moving'
+                std::vector<std::string> contents;
+                for (size_t i = begin; i < end; ++i) {
+                    std::string content;
+                    if (!contentOf(responses[i - begin], content)) {
+                        std::cerr << "[Router] Cannot read " << moving[i] << " on shard " << s << std::endl;
+                        complete = false;
+                        continue;
+                    }
+                    writes.emplace_back(ring.owner(moving[i]), writeLine(moving[i], content));
+                    copied.push_back(i);
+                    contents.push_back(std::move(content));
+                }
+                std::vector<std::string> written = callAll(writes);
+                for (size_t c = 0; c < copied.size(); ++c) checks.emplace_back(ring.owner(moving[copied[c]]), readLine(moving[copied[c]]));
+                std::vector<std::string> read_back = callAll(checks);
+
+                for (size_t c = 0; c < copied.size(); ++c) {
+                    if (isSuccess(written[c]) && sameContent(read_back[c], contents[c])) {
+                        deletes.emplace_back(s, deleteLine(moving[copied[c]]));
+                        files_moved++;
+                    } else {
+                        std::cerr << "[Router] Could not copy " << moving[copied[c]] << " off shard " << s << "; kept the original" << std::endl;
+                        complete = false;
+                    }
+                }
+                callAll(deletes);
+            }
+        }
+        std::cerr << "[Router] Rebalanced " << old_count << " -> " << shard_count << " shards, moved " << files_moved << " files" << std::endl;
+        return complete;
+    }
+
+    void retire(int shard) {
+        std::string listing = call(shard, "{\"action\":\"LIST\"}");
+        bool empty = arrayField(listing, "files").empty();
+        stop(shard);
+        if (!empty) {
+            std::cerr << "[Router] Shard " << shard << " still holds files, keeping " << shardStorage(shard) << std::endl;
+            return;
+        }
+        std::error_code ec;
+        std::string root = shardStorage(shard).substr(0, shardStorage(shard).size() - 1);
+        std::filesystem::remove_all(root, ec);
+        for (const char* suffix : {".manifest", ".img", ".img.index", ".img.journal"}) {
+            std::filesystem::remove(root + suffix, ec);
+        }
+    }
+
+    std::string statsJSON() const {
+        std::string json = "{\"shards\": " + std::to_string(shard_count);
+        json += ", \"requests\": " + std::to_string(requests_routed);
+        json += ", \"scatter_gathers\": " + std::to_string(scatter_gathers);
+        json += ", \"cross_shard_pairs\": " + std::to_string(cross_pairs);
+        json += ", \"files_moved\": " + std::to_string(files_moved);
+        json += ", \"cross_graph_bytes\": " + std::to_string(cross_graph.memoryUsage() + cross_names.memoryUsage());
+        json += "}";
+        return json;
+    }
+
+public:
+    ShardRouter(const std::string& engine, const std::string& base, int count, const std::string& trace_path = "")
+        : engine_path(engine), base_path(base), shard_count(count), ring(count) {
+        if (!base_path.empty() && base_path.back() != '/') base_path += '/';
+        if (!trace_path.empty()) trace.open(trace_path, std::ios::app);
+    }
+
+    ~ShardRouter() {
+        for (size_t s = 0; s < shards.size(); ++s) stop((int)s);
+    }
+
+    // Spawn the shards and move files if the shard count changed since last time
+    bool start() {
+        std::error_code ec;
+        std::filesystem::create_directories(base_path, ec);
+
+        int old_count = previousCount();
+        int running = std::max(shard_count, old_count);
+        shards.resize(running);
+        for (int s = 0; s < running; ++s) {
+            if (!spawn(s)) {
+                std::cerr << "[Router] Cannot start shard " << s << " (" << engine_path << ")" << std::endl;
+                return false;
+            }
+        }
+
+        if (old_count > 0 && old_count != shard_count) {
+            // Files left on their old shard would be unreachable; keep the old
+            // count on record so the next start retries the move
+            if (!rebalance(old_count)) {
+                std::cerr << "[Router] Rebalance incomplete, not starting" << std::endl;
+                return false;
+            }
+            for (int s = shard_count; s < old_count; ++s) retire(s);
+            shards.resize(shard_count);
+        }
+
+        std::ofstream record(countPath(), std::ios::trunc);
+        record << "CMFS-SHARDS " << shard_count << "\n";
+
+        std::cerr << "[Router] " << shard_count << " shards under " << base_path << std::endl;
+        return true;
+    }
+
+    // Serve stdin until it closes
+    void run() {
+        while (true) {
+            emitReady();
+            if (input_closed && queue.empty() && input.empty()) break;
+            pump(true);
+        }
+        writeOutput();
+    }
+};
+
+#endif
@@ -1,8 +1,13 @@
+#ifndef VIRTUALDISK_H
+#define VIRTUALDISK_H
+
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 
+#include "Metrics.h"
+
 // We simulate a disk with 4KB blocks
 const int BLOCK_SIZE = 4096; 
 
@@ -19,7 +24,7 @@ public:
         // Check if disk file exists, if not create it
         disk_stream.open(disk_filename, std::ios::in | std::ios::out | std::ios::binary);
         if (!disk_stream.is_open()) {
-            std::cout << "[Disk] Creating new virtual disk: " << filename << std::endl;
+            std::cerr << "[Disk] Creating new virtual disk: " << filename << std::endl;
             // Create file
             std::ofstream outfile(disk_filename, std::ios::binary);
             // Initialize with zeros (sparse file usually)
@@ -50,6 +55,8 @@ public:
         disk_stream.seekp(block_index * BLOCK_SIZE);
         disk_stream.write(data.data(), data.size());
         disk_stream.flush(); // Ensure it hits the physical disk
+        CMFS_COUNT(DISK_WRITE_OPS, 1);
+        CMFS_COUNT(DISK_WRITE_BYTES, data.size());
         return true;
     }
 
@@ -65,6 +72,8 @@ public:
         
         buffer.resize(BLOCK_SIZE);
         disk_stream.read(buffer.data(), BLOCK_SIZE);
+        CMFS_COUNT(DISK_READ_OPS, 1);
+        CMFS_COUNT(DISK_READ_BYTES, BLOCK_SIZE);
 
         return true;
     }
@@ -72,4 +81,6 @@ public:
     long long getCapacity() const {
         return total_blocks * BLOCK_SIZE;
     }
-};
\ No newline at end of file
+};
+
+#endif
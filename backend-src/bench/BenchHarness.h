@@ -0,0 +1,118 @@
+#ifndef BENCHHARNESS_H
+#define BENCHHARNESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../Metrics.h"
+
+// Shared plumbing for the benchmark binaries.
+// Every result is printed as one JSON object per line so runs can be diffed
+// by bench/compare.js (or anything else that reads JSON lines).
+
+class BenchTimer {
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+
+    uint64_t elapsedNanos() const {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+};
+
+// Latency samples for one benchmark, bucketed with the engine's own histogram
+class BenchResult {
+private:
+    std::string name;
+    std::vector<uint64_t> hist;
+    uint64_t ops = 0;
+    uint64_t total_nanos = 0;
+    // Extra numeric fields (hit ratio, bytes, ...) reported alongside the timings
+    std::map<std::string, double> extras;
+
+public:
+    explicit BenchResult(const std::string& bench_name) : name(bench_name), hist(HIST_BUCKETS, 0) {}
+
+    void record(uint64_t nanos) {
+        hist[histBucket(nanos)]++;
+        ops++;
+        total_nanos += nanos;
+    }
+
+    void set(const std::string& key, double value) { extras[key] = value; }
+
+    uint64_t count() const { return ops; }
+
+    std::string toJSON() const {
+        std::string json = "{\"bench\": \"" + name + "\", \"ops\": " + std::to_string(ops);
+        json += ", \"total_ms\": " + std::to_string(total_nanos / 1e6);
+        json += ", \"ns_per_op\": " + std::to_string(ops ? (double)total_nanos / ops : 0.0);
+        json += ", \"ops_per_sec\": " + std::to_string(total_nanos ? ops * 1e9 / total_nanos : 0.0);
+        json += ", \"p50_ns\": " + std::to_string(Metrics::percentile(hist, 0.50));
+        json += ", \"p99_ns\": " + std::to_string(Metrics::percentile(hist, 0.99));
+        json += ", \"p999_ns\": " + std::to_string(Metrics::percentile(hist, 0.999));
+        for (const auto& extra : extras) {
+            json += ", \"" + extra.first + "\": " + std::to_string(extra.second);
+        }
+        json += "}";
+        return json;
+    }
+};
+
+// Minimal "--key value" flag parsing shared by the bench binaries
+class BenchArgs {
+private:
+    std::map<std::string, std::string> values;
+
+public:
+    BenchArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) continue;
+            std::string key = arg.substr(2);
+            bool has_value = i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0;
+            values[key] = has_value ? argv[++i] : "1";
+        }
+    }
+
+    bool has(const std::string& key) const { return values.count(key) > 0; }
+
+    std::string get(const std::string& key, const std::string& fallback) const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : it->second;
+    }
+
+    uint64_t getInt(const std::string& key, uint64_t fallback) const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : std::strtoull(it->second.c_str(), nullptr, 10);
+    }
+
+    double getDouble(const std::string& key, double fallback) const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : std::strtod(it->second.c_str(), nullptr);
+    }
+};
+
+// Keeps the optimizer from discarding a benchmarked result
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    // No inline asm (MSVC): publish the value's address and fence the compiler
+    static const void* volatile sink;
+    sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+#endif
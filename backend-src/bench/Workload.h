@@ -0,0 +1,230 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic workload generator + trace file I/O.
+// A trace is just the protocol lines the Node bridge sends, one per line,
+// so a generated trace, a recorded one (CMFS_TRACE_FILE) and a hand-written
+// one are interchangeable and can also be piped straight into cmfs.
+
+// Draws ranks 0..n-1 with P(k) proportional to 1 / (k+1)^s
+class ZipfGenerator {
+private:
+    std::vector<double> cdf;
+
+public:
+    ZipfGenerator(size_t n, double s) : cdf(n) {
+        double sum = 0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += 1.0 / std::pow((double)(k + 1), s);
+            cdf[k] = sum;
+        }
+        for (double& c : cdf) c /= sum;
+    }
+
+    template <typename Rng>
+    size_t next(Rng& rng) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        size_t k = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return std::min(k, cdf.size() - 1);
+    }
+};
+
+struct WorkloadConfig {
+    uint64_t seed = 42;
+    size_t files = 1000;
+    size_t ops = 20000;
+    double zipf_s = 0.99;        // File (and keyword) popularity skew
+    size_t file_size = 2048;     // Bytes of content per WRITE
+    size_t chain_length = 4;     // Files are grouped into chains f, f+1, ... f+len-1
+    double chain_prob = 0.6;     // Chance the next READ follows the chain instead of Zipf
+    size_t keywords = 32;
+    size_t tags_per_file = 2;
+    bool text_content = false;   // Word-based (compressible) content instead of random letters
+    double duplicate_pct = 0;    // Share of WRITEs that copy an earlier file (dedup workloads)
+
+    // Operation mix (percent, remainder goes to SUGGEST_KEYS)
+    double read_pct = 70;
+    double write_pct = 10;
+    double search_pct = 12;
+    double list_pct = 3;
+};
+
+struct Workload {
+    std::vector<std::string> setup; // Populate the store (WRITE + TAG)
+    std::vector<std::string> ops;   // The measured phase
+};
+
+inline std::string workloadFileName(size_t index) {
+    std::string digits = std::to_string(index);
+    return "f" + std::string(digits.size() < 7 ? 7 - digits.size() : 0, '0') + digits + ".txt";
+}
+
+inline std::string workloadKeyword(size_t index) {
+    return "tag" + std::to_string(index);
+}
+
+template <typename Rng>
+std::string workloadContent(Rng& rng, size_t size) {
+    std::string content(size, 'a');
+    std::uniform_int_distribution<int> letter(0, 25);
+    for (char& c : content) c = (char)('a' + letter(rng));
+    return content;
+}
+
+// Prose-like content: Zipf-distributed words from a fixed vocabulary, so it
+// compresses roughly like real text does
+template <typename Rng>
+std::string workloadText(Rng& rng, size_t size) {
+    static const std::vector<std::string> vocabulary = [] {
+        std::mt19937_64 vocab_rng(7);
+        std::uniform_int_distribution<int> length(2, 9);
+        std::uniform_int_distribution<int> letter(0, 25);
+        std::vector<std::string> words(512);
+        for (std::string& word : words) {
+            word.resize(length(vocab_rng));
+            for (char& c : word) c = (char)('a' + letter(vocab_rng));
+        }
+        return words;
+    }();
+    static ZipfGenerator word_zipf(vocabulary.size(), 1.0);
+
+    std::string content;
+    content.reserve(size + 16);
+    while (content.size() < size) {
+        content += vocabulary[word_zipf.next(rng)];
+        content += ' ';
+    }
+    content.resize(size);
+    return content;
+}
+
+// Generates WRITE payloads and remembers them, so duplicate writes can copy an
+// earlier file. A copy spanning several 4 KB blocks gets its last 64 bytes
+// rewritten, like an edited draft; smaller copies are exact.
+class ContentSource {
+private:
+    const WorkloadConfig& config;
+    std::vector<std::string> written; // Only kept when duplicates are requested
+
+public:
+    explicit ContentSource(const WorkloadConfig& c) : config(c) {}
+
+    template <typename Rng>
+    std::string next(Rng& rng) {
+        std::string content;
+        bool duplicate = !written.empty() && std::uniform_real_distribution<double>(0.0, 100.0)(rng) < config.duplicate_pct;
+        if (duplicate) {
+            content = written[std::uniform_int_distribution<size_t>(0, written.size() - 1)(rng)];
+            if (content.size() > 4096) {
+                std::string edit = config.text_content ? workloadText(rng, 64) : workloadContent(rng, 64);
+                content.replace(content.size() - 64, 64, edit);
+            }
+        } else {
+            content = config.text_content ? workloadText(rng, config.file_size) : workloadContent(rng, config.file_size);
+        }
+        if (config.duplicate_pct > 0) written.push_back(content);
+        return content;
+    }
+};
+
+inline Workload generateWorkload(const WorkloadConfig& config) {
+    std::mt19937_64 rng(config.seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    ZipfGenerator file_zipf(config.files, config.zipf_s);
+    ZipfGenerator key_zipf(config.keywords, config.zipf_s);
+    ContentSource contents(config);
+    Workload workload;
+
+    // --- Setup: every file written once and tagged ---
+    for (size_t f = 0; f < config.files; ++f) {
+        std::string name = workloadFileName(f);
+        workload.setup.push_back("{\"action\":\"WRITE\",\"file\":\"" + name + "\",\"data\":\"" + contents.next(rng) + "\"}");
+
+        std::vector<size_t> tags;
+        for (size_t attempt = 0; tags.size() < config.tags_per_file && attempt < 4 * config.tags_per_file; ++attempt) {
+            size_t k = key_zipf.next(rng);
+            if (std::find(tags.begin(), tags.end(), k) == tags.end()) tags.push_back(k);
+        }
+        for (size_t k : tags) {
+            workload.setup.push_back("{\"action\":\"TAG\",\"file\":\"" + name + "\",\"key\":\"" + workloadKeyword(k) + "\"}");
+        }
+    }
+
+    // --- Measured phase ---
+    const double read_cut = config.read_pct / 100.0;
+    const double write_cut = read_cut + config.write_pct / 100.0;
+    const double search_cut = write_cut + config.search_pct / 100.0;
+    const double list_cut = search_cut + config.list_pct / 100.0;
+    bool has_current = false;
+    size_t current = 0;
+
+    for (size_t i = 0; i < config.ops; ++i) {
+        double p = coin(rng);
+        if (p < read_cut) {
+            // Correlated chain: after f, the user tends to open f+1 of the same chain
+            size_t next;
+            bool in_chain = config.chain_length > 1 && (current + 1) % config.chain_length != 0 && current + 1 < config.files;
+            if (has_current && in_chain && coin(rng) < config.chain_prob) {
+                next = current + 1;
+            } else {
+                next = file_zipf.next(rng);
+            }
+
+            if (has_current && next != current) {
+                workload.ops.push_back("{\"action\":\"ACCESS_PAIR\",\"source\":\"" + workloadFileName(current) + "\",\"target\":\"" + workloadFileName(next) + "\"}");
+            }
+            workload.ops.push_back("{\"action\":\"READ\",\"file\":\"" + workloadFileName(next) + "\"}");
+            current = next;
+            has_current = true;
+        } else if (p < write_cut) {
+            size_t f = file_zipf.next(rng);
+            workload.ops.push_back("{\"action\":\"WRITE\",\"file\":\"" + workloadFileName(f) + "\",\"data\":\"" + contents.next(rng) + "\"}");
+        } else if (p < search_cut) {
+            workload.ops.push_back("{\"action\":\"SEARCH_KEY\",\"key\":\"" + workloadKeyword(key_zipf.next(rng)) + "\"}");
+        } else if (p < list_cut) {
+            workload.ops.push_back("{\"action\":\"LIST\"}");
+        } else {
+            std::string keyword = workloadKeyword(key_zipf.next(rng));
+            workload.ops.push_back("{\"action\":\"SUGGEST_KEYS\",\"prefix\":\"" + keyword.substr(0, 4) + "\"}");
+        }
+    }
+
+    return workload;
+}
+
+// --- Trace files ---
+inline bool saveTrace(const std::string& path, const std::vector<std::string>& lines) {
+    std::ofstream outfile(path);
+    if (!outfile.is_open()) return false;
+    for (const std::string& line : lines) outfile << line << '\n';
+    return true;
+}
+
+inline bool loadTrace(const std::string& path, std::vector<std::string>& lines) {
+    std::ifstream infile(path);
+    if (!infile.is_open()) return false;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (!line.empty()) lines.push_back(line);
+    }
+    return true;
+}
+
+// Short label for a protocol line, used to group latencies per command
+inline std::string traceAction(const std::string& line) {
+    const std::string marker = "\"action\":\"";
+    size_t start = line.find(marker);
+    if (start == std::string::npos) return "UNKNOWN";
+    start += marker.size();
+    return line.substr(start, line.find('"', start) - start);
+}
+
+#endif
@@ -0,0 +1,435 @@
+// Micro-benchmarks for each engine data structure in isolation.
+// Prints one JSON result line per benchmark.
+//
+// Usage: bench_components [--n N] [--ops N] [--seed S] [--zipf S] [--cache-blocks N]
+//                         [--disk-blocks N] [--dup-pct P] [--only NAME_PREFIX]
+
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../CognitiveDFS.h"
+#include "BenchHarness.h"
+#include "Workload.h"
+
+struct ComponentConfig {
+    uint64_t seed;
+    size_t n;            // Distinct keys (files)
+    size_t ops;          // Measured operations per benchmark
+    double zipf_s;
+    size_t cache_blocks;
+    size_t disk_blocks;
+    double dup_pct;      // Share of duplicate files in the dedup benchmark
+    std::string only;
+};
+
+static bool selected(const ComponentConfig& config, const std::string& name) {
+    return config.only.empty() || name.rfind(config.only, 0) == 0;
+}
+
+static void emit(const BenchResult& result) {
+    std::cout << result.toJSON() << std::endl;
+}
+
+// --- FileRegistry ---
+static void benchRegistry(const ComponentConfig& config) {
+    if (!selected(config, "registry")) return;
+    FileRegistry registry;
+
+    BenchResult intern("registry_intern");
+    for (size_t i = 0; i < config.n; ++i) {
+        std::string name = workloadFileName(i);
+        BenchTimer timer;
+        doNotOptimize(registry.intern(name));
+        intern.record(timer.elapsedNanos());
+    }
+    intern.set("memory_bytes", (double)registry.memoryUsage());
+    emit(intern);
+
+    std::mt19937_64 rng(config.seed);
+    ZipfGenerator zipf(config.n, config.zipf_s);
+    BenchResult lookup("registry_lookup");
+    for (size_t i = 0; i < config.ops; ++i) {
+        std::string name = workloadFileName(zipf.next(rng));
+        BenchTimer timer;
+        doNotOptimize(registry.lookup(name));
+        lookup.record(timer.elapsedNanos());
+    }
+    emit(lookup);
+
+    // Startup path: rebuild the registry from a manifest-style name buffer
+    std::string buffer;
+    for (size_t i = 0; i < config.n; ++i) {
+        buffer += workloadFileName(i);
+        buffer += '\n';
+    }
+    FileRegistry loaded;
+    BenchResult load("registry_load_names");
+    BenchTimer timer;
+    loaded.loadNames(std::move(buffer), 0);
+    load.record(timer.elapsedNanos());
+    load.set("files", (double)loaded.size());
+    emit(load);
+}
+
+// --- CacheManager ---
+static void benchCache(const ComponentConfig& config) {
+    if (!selected(config, "cache")) return;
+    CacheManager cache(config.cache_blocks);
+    std::mt19937_64 rng(config.seed);
+    ZipfGenerator zipf(config.n, config.zipf_s);
+    std::vector<char> block(BLOCK_SIZE, 'x');
+    CacheBlock out("", 0);
+
+    // Read-through: get, and on a miss put (what READ does)
+    BenchResult result("cache_zipf_read_through");
+    uint64_t hits = 0;
+    for (size_t i = 0; i < config.ops; ++i) {
+        std::string key = std::to_string(zipf.next(rng)) + "#0";
+        BenchTimer timer;
+        if (cache.getBlock(key, out)) {
+            hits++;
+        } else {
+            cache.putBlock(key, block);
+        }
+        result.record(timer.elapsedNanos());
+    }
+    result.set("hit_ratio", config.ops ? (double)hits / config.ops : 0.0);
+    result.set("capacity_blocks", (double)config.cache_blocks);
+    result.set("memory_bytes", (double)cache.memoryUsage());
+    emit(result);
+}
+
+// --- BlockCodec ---
+static void benchCodec(const ComponentConfig& config) {
+    if (!selected(config, "codec")) return;
+    std::mt19937_64 rng(config.seed);
+    std::vector<std::string> blocks(std::min<size_t>(config.n, 256));
+    for (std::string& block : blocks) block = workloadText(rng, BLOCK_SIZE);
+
+    std::vector<std::vector<char>> packed(blocks.size());
+    uint64_t raw_bytes = 0, packed_bytes = 0;
+    BenchResult compress("codec_compress");
+    for (size_t i = 0; i < config.ops; ++i) {
+        size_t b = i % blocks.size();
+        BenchTimer timer;
+        BlockCodec::compress(blocks[b].data(), blocks[b].size(), packed[b]);
+        compress.record(timer.elapsedNanos());
+        if (i < blocks.size()) {
+            raw_bytes += blocks[b].size();
+            packed_bytes += packed[b].size();
+        }
+    }
+    compress.set("ratio", packed_bytes ? (double)raw_bytes / packed_bytes : 0.0);
+    emit(compress);
+
+    std::vector<char> out(BLOCK_SIZE);
+    BenchResult decompress("codec_decompress");
+    for (size_t i = 0; i < config.ops; ++i) {
+        size_t b = i % blocks.size();
+        BenchTimer timer;
+        doNotOptimize(BlockCodec::decompress(packed[b].data(), packed[b].size(), out.data(), out.size()));
+        decompress.record(timer.elapsedNanos());
+    }
+    emit(decompress);
+}
+
+// --- CacheManager with the compressed tier ---
+// Same memory as a plain cache of --cache-blocks: half of it holds raw blocks,
+// the other half compressed ones. Reports hit ratio against the plain cache on
+// the same key sequence, how many blocks fit (effective capacity), and the
+// latency of a hit in each tier. A compressed hit pays for decompressing the
+// block and for compressing the one it pushes out of the raw tier.
+static void benchTieredCache(const ComponentConfig& config) {
+    if (!selected(config, "cache_tiered")) return;
+    std::mt19937_64 rng(config.seed);
+    std::vector<std::vector<char>> contents(256);
+    for (std::vector<char>& content : contents) {
+        std::string text = workloadText(rng, BLOCK_SIZE);
+        content.assign(text.begin(), text.end());
+    }
+
+    ZipfGenerator zipf(config.n, config.zipf_s);
+    std::vector<size_t> keys(config.ops);
+    for (size_t& key : keys) key = zipf.next(rng);
+
+    size_t budget = config.cache_blocks * BLOCK_SIZE;
+    CacheManager plain(config.cache_blocks);
+    CacheManager tiered(std::max<size_t>(1, config.cache_blocks / 2), budget / 2);
+    CacheBlock out("", 0);
+
+    uint64_t plain_hits = 0;
+    for (size_t key : keys) {
+        std::string id = std::to_string(key) + "#0";
+        if (plain.getBlock(id, out)) {
+            plain_hits++;
+        } else {
+            plain.putBlock(id, contents[key % contents.size()]);
+        }
+    }
+
+    BenchResult all("cache_tiered_read_through");
+    BenchResult primary_hit("cache_tiered_primary_hit");
+    BenchResult compressed_hit("cache_tiered_compressed_hit");
+    uint64_t hits = 0;
+    for (size_t key : keys) {
+        std::string id = std::to_string(key) + "#0";
+        bool resident = tiered.contains(id);
+        bool compressed = tiered.isCompressed(id);
+        BenchTimer timer;
+        if (tiered.getBlock(id, out)) {
+            hits++;
+        } else {
+            tiered.putBlock(id, contents[key % contents.size()]);
+        }
+        uint64_t nanos = timer.elapsedNanos();
+        all.record(nanos);
+        if (resident) (compressed ? compressed_hit : primary_hit).record(nanos);
+    }
+    all.set("hit_ratio", config.ops ? (double)hits / config.ops : 0.0);
+    all.set("plain_hit_ratio", config.ops ? (double)plain_hits / config.ops : 0.0);
+    all.set("effective_capacity_blocks", (double)(tiered.size() + tiered.compressedSize()));
+    all.set("plain_capacity_blocks", (double)plain.size());
+    all.set("memory_bytes", (double)tiered.memoryUsage());
+    all.set("plain_memory_bytes", (double)plain.memoryUsage());
+    emit(all);
+    emit(primary_hit);
+    emit(compressed_hit);
+}
+
+// --- ContentStore (dedup) ---
+// --n files of two blocks each; --dup-pct of them copy an earlier file with the
+// tail edited, so their first block is shared.
+static void benchDedup(const ComponentConfig& config) {
+    if (!selected(config, "dedup")) return;
+    std::random_device rd;
+    std::string image = (fs::temp_directory_path() / ("cmfs_bench_cas_" + std::to_string(rd()) + ".img")).string();
+    std::mt19937_64 rng(config.seed);
+
+    WorkloadConfig workload;
+    workload.text_content = true;
+    workload.duplicate_pct = config.dup_pct;
+    workload.file_size = 2 * BLOCK_SIZE;
+    ContentSource source(workload);
+    size_t files = std::max<size_t>(1, std::min(config.n, config.disk_blocks / 2));
+    std::vector<std::string> contents(files);
+    for (std::string& content : contents) content = source.next(rng);
+    {
+        ContentStore store(image, (long long)config.disk_blocks);
+        FileRegistry registry;
+        store.load(registry); // Starts the journal
+        std::vector<long long> freed;
+
+        BenchResult write("dedup_write");
+        for (size_t f = 0; f < files; ++f) {
+            std::string name = workloadFileName(f);
+            BenchTimer timer;
+            store.writeFile((FileID)f, name, contents[f], freed);
+            write.record(timer.elapsedNanos());
+        }
+        write.set("dup_pct", config.dup_pct);
+        write.set("logical_bytes", (double)store.logicalBytes());
+        write.set("stored_bytes", (double)store.storedBytes());
+        write.set("blocks_used", (double)store.blocksUsed());
+        write.set("dedup_ratio", store.dedupRatio());
+        emit(write);
+
+        std::uniform_int_distribution<size_t> any_file(0, files - 1);
+        std::string content;
+        BenchResult read("dedup_read");
+        for (size_t i = 0; i < std::min<size_t>(config.ops, 10 * files); ++i) {
+            BenchTimer timer;
+            store.readFile((FileID)any_file(rng), content);
+            read.record(timer.elapsedNanos());
+        }
+        emit(read);
+    }
+    std::error_code ec;
+    for (const char* suffix : {"", ".index", ".journal"}) fs::remove(image + suffix, ec);
+}
+
+// --- FilenameTrie ---
+static void benchTrie(const ComponentConfig& config) {
+    if (!selected(config, "trie")) return;
+    FilenameTrie trie;
+
+    BenchResult insert("trie_insert");
+    for (size_t i = 0; i < config.n; ++i) {
+        std::string name = workloadFileName(i);
+        BenchTimer timer;
+        trie.insert(name, (FileID)i);
+        insert.record(timer.elapsedNanos());
+    }
+    insert.set("memory_bytes", (double)trie.memoryUsage());
+    emit(insert);
+
+    std::mt19937_64 rng(config.seed);
+    ZipfGenerator zipf(config.n, config.zipf_s);
+    BenchResult search("trie_search");
+    for (size_t i = 0; i < config.ops; ++i) {
+        std::string name = workloadFileName(zipf.next(rng));
+        BenchTimer timer;
+        doNotOptimize(trie.search(name));
+        search.record(timer.elapsedNanos());
+    }
+    emit(search);
+
+    // Prefixes that match ~1/1000th of the namespace
+    BenchResult prefix("trie_prefix");
+    size_t prefix_ops = std::max<size_t>(1, config.ops / 100);
+    for (size_t i = 0; i < prefix_ops; ++i) {
+        std::string name = workloadFileName(zipf.next(rng));
+        std::string p = name.substr(0, 5);
+        BenchTimer timer;
+        doNotOptimize(trie.findWithPrefix(p).size());
+        prefix.record(timer.elapsedNanos());
+    }
+    emit(prefix);
+}
+
+// --- DependencyGraph ---
+static void benchGraph(const ComponentConfig& config) {
+    if (!selected(config, "graph")) return;
+    DependencyGraph graph;
+    std::mt19937_64 rng(config.seed);
+    ZipfGenerator zipf(config.n, config.zipf_s);
+    std::uniform_int_distribution<int> hop(1, 4);
+
+    // Correlated pairs: a file mostly leads to one of its near neighbours
+    BenchResult update("graph_update");
+    for (size_t i = 0; i < config.ops; ++i) {
+        FileID source = (FileID)zipf.next(rng);
+        FileID target = (FileID)((source + hop(rng)) % config.n);
+        BenchTimer timer;
+        graph.updateConnection(source, target);
+        update.record(timer.elapsedNanos());
+    }
+    update.set("memory_bytes", (double)graph.memoryUsage());
+    emit(update);
+
+    BenchResult top("graph_top_dependencies");
+    for (size_t i = 0; i < config.ops; ++i) {
+        FileID source = (FileID)zipf.next(rng);
+        BenchTimer timer;
+        doNotOptimize(graph.getTopDependencies(source).size());
+        top.record(timer.elapsedNanos());
+    }
+    emit(top);
+
+    // DELETE path: drop files with both outgoing and incoming edges
+    BenchResult remove("graph_remove");
+    for (size_t i = 0; i < std::min(config.ops, config.n); ++i) {
+        BenchTimer timer;
+        graph.removeFile((FileID)i);
+        remove.record(timer.elapsedNanos());
+    }
+    remove.set("memory_bytes", (double)graph.memoryUsage());
+    emit(remove);
+}
+
+// --- Keyword index (lives inside CognitiveDFS) ---
+static void benchKeywordIndex(const ComponentConfig& config) {
+    if (!selected(config, "keyword")) return;
+    std::random_device rd;
+    std::string storage = (fs::temp_directory_path() / ("cmfs_bench_kw_" + std::to_string(rd()))).string();
+    std::ostream sink(nullptr);
+    std::mt19937_64 rng(config.seed);
+    const size_t keywords = 64;
+    ZipfGenerator key_zipf(keywords, config.zipf_s);
+    {
+        CognitiveDFS engine(CognitiveDFS::DEFAULT_CACHE_BLOCKS, storage, sink);
+        for (size_t i = 0; i < config.n; ++i) {
+            engine.writeFile(workloadFileName(i), "x");
+        }
+
+        BenchResult tag("keyword_tag");
+        for (size_t i = 0; i < config.n; ++i) {
+            std::string key = workloadKeyword(key_zipf.next(rng));
+            BenchTimer timer;
+            engine.tagFile(workloadFileName(i), key);
+            tag.record(timer.elapsedNanos());
+        }
+        emit(tag);
+
+        BenchResult search("keyword_search");
+        for (size_t i = 0; i < config.ops; ++i) {
+            std::string key = workloadKeyword(key_zipf.next(rng));
+            BenchTimer timer;
+            engine.searchByKeyword(key);
+            search.record(timer.elapsedNanos());
+        }
+        emit(search);
+
+        BenchResult suggest("keyword_suggest");
+        for (size_t i = 0; i < config.ops; ++i) {
+            std::string key = workloadKeyword(key_zipf.next(rng));
+            BenchTimer timer;
+            engine.suggestKeywords(key.substr(0, 4));
+            suggest.record(timer.elapsedNanos());
+        }
+        emit(suggest);
+    }
+    std::error_code ec;
+    fs::remove_all(storage, ec);
+    fs::remove(storage + ".manifest", ec);
+}
+
+// --- VirtualDisk ---
+static void benchDisk(const ComponentConfig& config) {
+    if (!selected(config, "disk")) return;
+    std::random_device rd;
+    std::string image = (fs::temp_directory_path() / ("cmfs_bench_disk_" + std::to_string(rd()) + ".img")).string();
+    std::mt19937_64 rng(config.seed);
+    std::uniform_int_distribution<long long> any_block(0, (long long)config.disk_blocks - 1);
+    std::vector<char> block(BLOCK_SIZE, 'd');
+    std::vector<char> buffer;
+    {
+        VirtualDisk disk(image, (long long)config.disk_blocks);
+
+        BenchResult write("disk_write_sequential");
+        for (size_t b = 0; b < config.disk_blocks; ++b) {
+            BenchTimer timer;
+            disk.writeBlock((long long)b, block);
+            write.record(timer.elapsedNanos());
+        }
+        write.set("bytes", (double)config.disk_blocks * BLOCK_SIZE);
+        emit(write);
+
+        BenchResult read("disk_read_random");
+        for (size_t i = 0; i < config.ops; ++i) {
+            BenchTimer timer;
+            disk.readBlock(any_block(rng), buffer);
+            read.record(timer.elapsedNanos());
+        }
+        read.set("bytes", (double)config.ops * BLOCK_SIZE);
+        emit(read);
+    }
+    std::error_code ec;
+    fs::remove(image, ec);
+}
+
+int main(int argc, char** argv) {
+    BenchArgs args(argc, argv);
+    ComponentConfig config;
+    config.seed = args.getInt("seed", 42);
+    config.n = std::max<uint64_t>(1, args.getInt("n", 10000));
+    config.ops = args.getInt("ops", 100000);
+    config.zipf_s = args.getDouble("zipf", 0.99);
+    config.cache_blocks = std::max<uint64_t>(1, args.getInt("cache-blocks", 1024));
+    config.disk_blocks = std::max<uint64_t>(1, args.getInt("disk-blocks", 4096));
+    config.dup_pct = args.getDouble("dup-pct", 30);
+    config.only = args.get("only", "");
+
+    benchRegistry(config);
+    benchCache(config);
+    benchCodec(config);
+    benchTieredCache(config);
+    benchDedup(config);
+    benchTrie(config);
+    benchGraph(config);
+    benchKeywordIndex(config);
+    benchDisk(config);
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Compare two benchmark result files (JSON lines from bench_components /
+// bench_engine) and exit non-zero if anything got slower than the threshold.
+//
+// Usage: node compare.js <baseline.jsonl> <current.jsonl> [thresholdPercent=10]
+
+const fs = require('fs');
+
+function load(file) {
+    const results = {};
+    fs.readFileSync(file, 'utf8').split('\n').forEach(line => {
+        const trimmed = line.trim();
+        if (!trimmed.startsWith('{')) return;
+        const row = JSON.parse(trimmed);
+        if (row.bench && row.ns_per_op !== undefined) results[row.bench] = row;
+    });
+    return results;
+}
+
+const [baselineFile, currentFile, thresholdArg] = process.argv.slice(2);
+if (!baselineFile || !currentFile) {
+    console.error("Usage: node compare.js <baseline.jsonl> <current.jsonl> [thresholdPercent]");
+    process.exit(2);
+}
+
+const threshold = Number(thresholdArg || 10);
+const baseline = load(baselineFile);
+const current = load(currentFile);
+let regressions = 0;
+
+Object.keys(current).sort().forEach(name => {
+    const before = baseline[name];
+    if (!before) {
+        console.log(`${name.padEnd(32)} (new)`);
+        return;
+    }
+
+    const after = current[name];
+    ['ns_per_op', 'p99_ns'].forEach(metric => {
+        if (!before[metric]) return;
+        const change = ((after[metric] - before[metric]) / before[metric]) * 100;
+        const flag = change > threshold ? 'REGRESSION' : '';
+        if (flag) regressions++;
+        console.log(`${name.padEnd(32)} ${metric.padEnd(10)} ${String(before[metric]).padStart(14)} -> ${String(after[metric]).padStart(14)}  ${change.toFixed(1).padStart(7)}%  ${flag}`);
+    });
+});
+
+process.exit(regressions > 0 ? 1 : 0);
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <csignal>
+#include <thread>
+#include <filesystem>
+
+#include "ShardRouter.h"
+
+// --- Shard router: a drop-in for cmfs that fans out to N engine processes ---
+int main(int argc, char** argv) {
+    // CMFS_SHARDS: number of engine processes (default: one per core)
+    // CMFS_STORAGE: base directory; shard i keeps its files in <base>/shard-<i>/
+    // CMFS_ENGINE: path of the cmfs executable (default: next to this one); never the router itself
+    // CMFS_TRACE_FILE: if set, append every received command line
+    // Everything else (CMFS_CACHE_BLOCKS, CMFS_DEDUP, ...) is passed on to each shard.
+    const char* shards_env = std::getenv("CMFS_SHARDS");
+    const char* storage_env = std::getenv("CMFS_STORAGE");
+    const char* engine_env = std::getenv("CMFS_ENGINE");
+    const char* trace_env = std::getenv("CMFS_TRACE_FILE");
+
+    int shards = shards_env ? std::atoi(shards_env) : (int)std::thread::hardware_concurrency();
+    if (shards < 1) shards = 1;
+
+    std::string engine;
+    if (engine_env) {
+        engine = engine_env;
+    } else {
+        std::string self = argc > 0 ? argv[0] : "";
+        size_t slash = self.rfind('/');
+        engine = (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/cmfs";
+    }
+
+    // Each shard would start shards of its own, without end
+    std::error_code ec;
+    if (std::filesystem::equivalent(engine, "/proc/self/exe", ec)) {
+        std::cerr << "[Router] CMFS_ENGINE points at the router itself (" << engine << "); it must be the cmfs engine" << std::endl;
+        return 1;
+    }
+
+    // A shard that exits shows up as EOF on its pipe; don't die on the write
+    std::signal(SIGPIPE, SIG_IGN);
+
+    ShardRouter router(engine, storage_env ? storage_env : "C:/cmfs_storage/", shards, trace_env ? trace_env : "");
+    if (!router.start()) return 1;
+    router.run();
+    return 0;
+}
@@ -0,0 +1,168 @@
+// End-to-end test of sharded mode: runs cmfs_router (with real cmfs shards)
+// against a scratch storage directory and checks what comes back.
+// Usage: node router_test.js <path to cmfs_router>
+const { spawnSync } = require('child_process');
+const assert = require('assert');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const router = process.argv[2];
+if (!router || !fs.existsSync(router)) {
+    console.error('usage: node router_test.js <cmfs_router>');
+    process.exit(2);
+}
+
+const storage = fs.mkdtempSync(path.join(os.tmpdir(), 'cmfs-router-test-'));
+
+// One router process: send the requests, return one parsed response per request
+function run(shards, requests) {
+    const input = requests.map((r) => JSON.stringify(r) + '\n').join('');
+    const result = spawnSync(router, [], {
+        input,
+        env: { ...process.env, CMFS_STORAGE: storage, CMFS_SHARDS: String(shards) },
+        encoding: 'utf8',
+        timeout: 60000,
+    });
+    assert.strictEqual(result.status, 0, 'router failed: ' + result.stderr);
+    const lines = result.stdout.split('\n').filter((line) => line.length > 0);
+    assert.strictEqual(lines.length, requests.length, 'one response per request:\n' + result.stdout);
+    return lines.map((line) => JSON.parse(line));
+}
+
+// Which shard directory holds each file
+function placement() {
+    const owners = {};
+    for (const dir of fs.readdirSync(storage)) {
+        const match = /^shard-(\d+)$/.exec(dir);
+        if (!match) continue;
+        for (const name of fs.readdirSync(path.join(storage, dir))) {
+            assert.strictEqual(owners[name], undefined, name + ' is on two shards');
+            owners[name] = Number(match[1]);
+        }
+    }
+    return owners;
+}
+
+const read = (file) => ({ action: 'READ', file });
+const write = (file, data) => ({ action: 'WRITE', file, data });
+const tag = (file, key) => ({ action: 'TAG', file, key });
+const names = (count) => Array.from({ length: count }, (_, i) => 'f' + i + '.txt');
+const contentOf = (file) => 'body of ' + file + ' with "quotes"\nand a second line';
+
+const tests = [];
+const test = (name, fn) => tests.push({ name, fn });
+
+test('LIST, SEARCH_KEY and SUGGEST_KEYS merge every shard', () => {
+    const files = names(30);
+    const responses = run(3, [
+        ...files.map((f) => write(f, contentOf(f))),
+        ...files.filter((_, i) => i % 3 === 0).map((f) => tag(f, 'alpha')),
+        ...files.filter((_, i) => i % 5 === 0).map((f) => tag(f, 'alps')),
+        { action: 'LIST' },
+        { action: 'SEARCH_KEY', key: 'alpha' },
+        { action: 'SEARCH_KEY', key: 'missing' },
+        { action: 'SUGGEST_KEYS', prefix: 'al' },
+    ]);
+    const [list, search, none, suggest] = responses.slice(-4);
+    const owners = placement();
+    assert.strictEqual(new Set(Object.values(owners)).size, 3, 'files spread over all shards');
+
+    assert.strictEqual(list.status, 'success');
+    assert.deepStrictEqual(list.files.map((f) => f.name).sort(), files.slice().sort());
+    const listed = Object.fromEntries(list.files.map((f) => [f.name, f.tags]));
+    assert.deepStrictEqual(listed['f0.txt'], ['alpha', 'alps']);
+
+    const tagged = files.filter((_, i) => i % 3 === 0);
+    assert.ok(new Set(tagged.map((f) => owners[f])).size > 1, 'tagged files on several shards');
+    assert.deepStrictEqual(search.files.slice().sort(), tagged.slice().sort());
+    assert.deepStrictEqual(none.files, []);
+    assert.deepStrictEqual(suggest.suggestions, ['alpha', 'alps']);
+});
+
+test('cross-shard ACCESS_PAIR shows up in READ predictions', () => {
+    const owners = placement();
+    const source = 'f0.txt';
+    const target = Object.keys(owners).find((f) => owners[f] !== owners[source]);
+    const local = Object.keys(owners).find((f) => f !== source && owners[f] === owners[source]);
+    const responses = run(3, [
+        { action: 'ACCESS_PAIR', source, target },
+        { action: 'ACCESS_PAIR', source, target },
+        { action: 'ACCESS_PAIR', source, target: local },
+        { action: 'ACCESS_PAIR', source, target: 'no-such-file.txt' },
+        read(source),
+        { action: 'STATS' },
+    ]);
+    assert.strictEqual(responses[0].status, 'success');
+    assert.strictEqual(responses[3].status, 'error');
+    const predictions = responses[4].predictions;
+    assert.strictEqual(responses[4].content, contentOf(source));
+    assert.deepStrictEqual(predictions.slice(0, 2), [target, local], 'heavier cross-shard edge first');
+    assert.deepStrictEqual(responses[4].prediction_weights.slice(0, 2), [2, 1]);
+    assert.ok(responses[5].router.cross_shard_pairs >= 2);
+});
+
+test('cross-shard RENAME moves content and tags, replaces the target, refuses bad names', () => {
+    const owners = placement();
+    const source = 'f1.txt';
+    const target = Object.keys(owners).find((f) => owners[f] !== owners[source]);
+    const other = Object.keys(owners).find((f) => f !== source && f !== target && owners[f] !== owners[source]);
+    const responses = run(3, [
+        tag(source, 'moved'),
+        tag(target, 'replaced'),
+        { action: 'RENAME', file: other, to: 'a"b' },
+        { action: 'RENAME', file: other, to: '.cmfs-move~' + target },
+        { action: 'RENAME', file: 'no-such-file.txt', to: target },
+        { action: 'RENAME', file: source, to: target },
+        read(target),
+        read(source),
+        read(other),
+        { action: 'SEARCH_KEY', key: 'replaced' },
+        { action: 'LIST' },
+    ]);
+    const [, , badName, scratchName, missing, renamed, moved, gone, untouched, search, list] = responses;
+    assert.deepStrictEqual([badName.status, badName.message], ['error', 'Invalid file name']);
+    assert.deepStrictEqual([scratchName.status, scratchName.message], ['error', 'Invalid file name']);
+    assert.strictEqual(missing.status, 'error');
+    assert.deepStrictEqual([renamed.status, renamed.file], ['success', target]);
+    assert.strictEqual(moved.content, contentOf(source));
+    assert.deepStrictEqual(moved.tags, ['moved']);
+    assert.strictEqual(gone.status, 'error');
+    assert.strictEqual(untouched.content, contentOf(other));
+    assert.deepStrictEqual(search.files, []);
+    assert.ok(list.files.every((f) => !f.name.startsWith('.cmfs-move~')), 'no scratch file left');
+    assert.strictEqual(placement()[target], owners[target]);
+});
+
+test('rebalance moves files when the shard count goes up and down', () => {
+    const before = run(3, [{ action: 'LIST' }])[0].files.map((f) => f.name).sort();
+    const check = (shards) => {
+        const responses = run(shards, [...before.map(read), { action: 'STATS' }]);
+        before.forEach((file, i) => assert.strictEqual(responses[i].status, 'success', file + ' readable'));
+        const owners = placement();
+        assert.deepStrictEqual(Object.keys(owners).sort(), before);
+        assert.ok(Object.values(owners).every((s) => s < shards), 'no file left on a removed shard');
+        assert.ok(fs.readFileSync(path.join(storage, 'SHARDS'), 'utf8').includes('CMFS-SHARDS ' + shards));
+        return responses[responses.length - 1].router.files_moved;
+    };
+    const contents = Object.fromEntries(run(3, before.map(read)).map((r, i) => [before[i], r.content]));
+
+    assert.ok(check(5) > 0, 'files moved going up');
+    assert.ok(check(2) > 0, 'files moved going down');
+    assert.ok(!fs.existsSync(path.join(storage, 'shard-4')), 'empty shards removed');
+    const after = run(2, before.map(read));
+    after.forEach((r, i) => assert.strictEqual(r.content, contents[before[i]]));
+});
+
+let failed = 0;
+for (const { name, fn } of tests) {
+    try {
+        fn();
+        console.log('ok - ' + name);
+    } catch (err) {
+        failed++;
+        console.log('not ok - ' + name + '\n' + err.stack);
+    }
+}
+fs.rmSync(storage, { recursive: true, force: true });
+process.exit(failed ? 1 : 0);
@@ -6,15 +6,17 @@ const path = require('path');
 
 console.log("1. Script started...");
 
-const exePath = path.join(__dirname, 'cmfs.exe');
+// CMFS_BRIDGE_ENGINE points the bridge at another build, e.g. cmfs_router for sharded mode
+// (CMFS_ENGINE is the router's own setting: the engine it runs for each shard)
+const exePath = process.env.CMFS_BRIDGE_ENGINE || path.join(__dirname, 'cmfs.exe');
 
 // Check if the file actually exists
 if (!fs.existsSync(exePath)) {
-    console.error("❌ ERROR: cmfs.exe not found at:", exePath);
+    console.error("❌ ERROR: engine not found at:", exePath);
     process.exit(1);
 }
 
-console.log("2. Found cmfs.exe, attempting to spawn...");
+console.log("2. Found " + path.basename(exePath) + ", attempting to spawn...");
 
 const cmfs = spawn(exePath);
 